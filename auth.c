@@ -0,0 +1,232 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Credential store definitions */
+#include "auth.h"
+/* Epoch definitions */
+#include "epoch.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* A struct representing a single username and password in the index */
+typedef struct{
+    uint64_t hash;                  /* Hash of the username */
+    const char *username;           /* NULL if the slot is empty */
+    const char *password;
+} ms_credential_t;
+
+/* A struct representing an open addressed hash index of credentials.
+ * The strings point into the text of the file it was loaded from */
+typedef struct{
+    char *text;
+    size_t count;
+    size_t mask;                    /* Number of slots minus one */
+    ms_credential_t slots[];
+} ms_auth_index_t;
+
+/* The published index, NULL until a file has been loaded */
+ms_auth_index_t *auth_index = NULL;
+
+/* The credentials file, and the state of it when last loaded */
+const char *auth_path = NULL;
+struct stat auth_loaded;
+
+/* Function definitions */
+void auth_index_free(void *index);
+void auth_reload_loop();
+
+bool auth_changed(struct stat *status);
+
+ms_auth_index_t* auth_load();
+
+void auth_start(const char *path){
+
+    pthread_t thread;
+
+    auth_path = path;
+    memset(&auth_loaded, 0, sizeof(struct stat));
+
+    auth_index = auth_load();
+    if (auth_index){
+        printf("Loaded %zu users from %s\n", auth_index->count, auth_path);
+    } else {
+        printf("No authentication file found\n");
+    }
+
+    pthread_create(&thread, NULL, (void*) auth_reload_loop, NULL);
+    pthread_detach(thread);
+}
+
+req_t auth_verify(ms_user_t user){
+
+    req_t result = invalid;
+    ms_auth_index_t *index;
+    ms_credential_t *slot;
+    uint64_t hash = hash_string(user.username);
+    size_t i;
+
+    epoch_enter();
+
+    index = __atomic_load_n(&auth_index, __ATOMIC_SEQ_CST);
+
+    /* A username may appear more than once, so check every match */
+    if (index){
+        for (i=hash & index->mask;index->slots[i].username!=NULL;i=(i+1) & index->mask){
+            slot = &index->slots[i];
+            if (slot->hash == hash && strcmp(slot->username, user.username) == 0 &&
+                    strcmp(slot->password, user.password) == 0){
+                result = valid;
+                break;
+            }
+        }
+    }
+
+    epoch_exit();
+
+    return result;
+}
+
+/***********************************************************************
+ * func:            The loop of the reload thread. Checks the
+ *                  credentials file for changes, and swaps in a new
+ *                  index when it has changed. Readers of the old index
+ *                  finish with it before it is freed.
+***********************************************************************/
+void auth_reload_loop(){
+
+    struct stat status;
+    ms_auth_index_t *index, *old;
+
+    while (true){
+        sleep(AUTH_RELOAD_INTERVAL);
+
+        if (stat(auth_path, &status) == ERROR || !auth_changed(&status)){
+            continue;
+        }
+
+        index = auth_load();
+        if (!index){
+            continue;
+        }
+
+        old = __atomic_exchange_n(&auth_index, index, __ATOMIC_SEQ_CST);
+
+        printf("\nReloaded %zu users from %s\n", index->count, auth_path);
+        fflush(stdout);
+
+        if (old){
+            epoch_retire(old, auth_index_free);
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Determines whether a file differs from the one the
+ *                  current index was loaded from.
+ * param status:    The current state of the file.
+***********************************************************************/
+bool auth_changed(struct stat *status){
+    return status->st_ino != auth_loaded.st_ino ||
+        status->st_size != auth_loaded.st_size ||
+        status->st_mtim.tv_sec != auth_loaded.st_mtim.tv_sec ||
+        status->st_mtim.tv_nsec != auth_loaded.st_mtim.tv_nsec;
+}
+
+/***********************************************************************
+ * func:            Reads the credentials file into a new index. Returns
+ *                  NULL if the file cannot be read.
+***********************************************************************/
+ms_auth_index_t* auth_load(){
+
+    int fd;
+    struct stat status;
+    char *text, *line, *end, *save, *username, *password;
+    size_t length = 0, lines = 1, slots, i;
+    ssize_t result;
+    ms_auth_index_t *index;
+
+    if ((fd = open(auth_path, O_RDONLY | O_CLOEXEC)) == ERROR){
+        return NULL;
+    }
+
+    if (fstat(fd, &status) == ERROR || !(text = malloc(status.st_size+1))){
+        close(fd);
+        return NULL;
+    }
+
+    while (length < (size_t)status.st_size){
+        result = read(fd, text+length, status.st_size-length);
+        if (result == 0 || (result == ERROR && errno != EINTR)){
+            break;
+        } else if (result > 0){
+            length += result;
+        }
+    }
+    text[length] = '\0';
+    close(fd);
+
+    for (i=0;i<length;i++){
+        lines += text[i] == '\n';
+    }
+
+    /* Each line holds at most one user */
+    slots = hash_slots(lines);
+
+    index = calloc(1, sizeof(ms_auth_index_t) + slots*sizeof(ms_credential_t));
+    if (!index){
+        free(text);
+        return NULL;
+    }
+
+    index->text = text;
+    index->mask = slots-1;
+
+    /* Dont read column headers */
+    line = strchr(text, '\n');
+    line = line ? line+1 : text+length;
+
+    for (;line<text+length;line=end+1){
+        end = strchr(line, '\n');
+        if (!end){
+            end = text+length;
+        }
+        *end = '\0';
+
+        username = strtok_r(line, "\t\r ", &save);
+        password = username ? strtok_r(NULL, "\t\r ", &save) : NULL;
+        if (!password){
+            continue;
+        }
+
+        uint64_t hash = hash_string(username);
+        for (i=hash & index->mask;index->slots[i].username!=NULL;i=(i+1) & index->mask);
+
+        index->slots[i].hash = hash;
+        index->slots[i].username = username;
+        index->slots[i].password = password;
+        index->count++;
+    }
+
+    auth_loaded = status;
+
+    return index;
+}
+
+/***********************************************************************
+ * func:            Frees an index retired by the reload thread.
+ * param index:     The index to free.
+***********************************************************************/
+void auth_index_free(void *index){
+    free(((ms_auth_index_t*)index)->text);
+    free(index);
+}
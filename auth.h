@@ -0,0 +1,29 @@
+#ifndef AUTH_H_
+#define AUTH_H_
+
+/* Utility definitions */
+#include "utils.h"
+
+/* Seconds between checks of the credentials file for changes */
+#define AUTH_RELOAD_INTERVAL 1
+
+/***********************************************************************
+ * func:            Loads the usernames and passwords in a given file
+ *                  into a hash index, and starts a thread that reloads
+ *                  the index whenever the file changes. The first line
+ *                  of the file holds column headers, and each line
+ *                  after holds a username and password separated by
+ *                  whitespace.
+ * param path:      The path of the credentials file.
+***********************************************************************/
+void auth_start(const char *path);
+
+/***********************************************************************
+ * func:            Checks a username and password against the index.
+ *                  Never waits on a reload, which swaps in the new
+ *                  index atomically. Returns valid or invalid.
+ * param user:      The user to check.
+***********************************************************************/
+req_t auth_verify(ms_user_t user);
+
+#endif /* AUTH_H_ */
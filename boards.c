@@ -0,0 +1,305 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Board pool definitions */
+#include "boards.h"
+/* Minesweeper definitions */
+#include "ms.h"
+/* Random number definitions */
+#include "rng.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Number of difficulties kept */
+#define BOARDS_RINGS 3
+
+/* A struct representing a place in a ring. Its sequence tells whether
+ * it is ready to be filled or taken on a given pass around the ring */
+typedef struct{
+    unsigned long sequence;
+    ms_game_t *game;
+} ms_board_slot_t;
+
+/* A struct representing a bounded lock free ring of ready made boards
+ * of a single configuration. The producer fills it at the tail, and any
+ * thread takes from the head. Each end sits on its own cache line */
+typedef struct{
+    const char *name;
+    ms_config_t config;
+    unsigned long head __attribute__((aligned(64)));
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long tail __attribute__((aligned(64)));
+    ms_board_slot_t slots[BOARDS_RING_SIZE];
+} ms_board_ring_t;
+
+ms_board_ring_t boards_rings[BOARDS_RINGS];
+
+/* Boards made for difficulties that are not kept */
+unsigned long boards_unpooled = 0;
+
+/* Boards given back and waiting to be reused, linked through their next
+ * pointers. Pushed by any thread, and taken all at once by the producer,
+ * and the number of boards reused and newly allocated so far */
+ms_game_t *boards_returned = NULL;
+unsigned long boards_reused = 0;
+unsigned long boards_allocated = 0;
+
+/* Whether a ring has fallen below the low watermark since the
+ * producer last refilled them */
+bool boards_wanted = true;
+pthread_mutex_t boards_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t boards_cond = PTHREAD_COND_INITIALIZER;
+
+/* Generator of the seeds of the boards made */
+ms_rng_t boards_rng;
+
+/* Function definitions */
+void boards_loop();
+void boards_reuse();
+void boards_ring_init(ms_board_ring_t *ring, const char *name, ms_config_t config);
+void boards_wake();
+
+bool boards_put(ms_board_ring_t *ring, ms_game_t *game);
+
+ms_board_ring_t* boards_ring_of(ms_config_t config);
+
+void boards_start(uint64_t seed){
+
+    pthread_t thread;
+
+    boards_ring_init(&boards_rings[0], "beginner", MS_BEGINNER);
+    boards_ring_init(&boards_rings[1], "intermediate", MS_INTERMEDIATE);
+    boards_ring_init(&boards_rings[2], "expert", MS_EXPERT);
+
+    rng_seed(&boards_rng, seed);
+
+    pthread_create(&thread, NULL, (void*) boards_loop, NULL);
+    pthread_detach(thread);
+}
+
+ms_game_t* boards_take(ms_config_t config){
+
+    ms_board_ring_t *ring = boards_ring_of(config);
+    ms_board_slot_t *slot;
+    ms_game_t *game;
+    unsigned long position, sequence;
+    long difference;
+
+    if (!ring){
+        __atomic_fetch_add(&boards_unpooled, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    while (true){
+        slot = &ring->slots[position & (BOARDS_RING_SIZE-1)];
+        sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        difference = (long)(sequence - (position+1));
+
+        if (difference == 0){
+            if (__atomic_compare_exchange_n(&ring->head, &position, position+1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                /* Hand the slot back to the producer for its next pass */
+                game = slot->game;
+                __atomic_store_n(&slot->sequence, position + BOARDS_RING_SIZE, __ATOMIC_RELEASE);
+
+                /* Bombs are not placed until the first reveal, so the
+                 * same board serves no-guess games too */
+                game->config = config;
+                __atomic_fetch_add(&ring->hits, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        } else if (difference < 0){
+            __atomic_fetch_add(&ring->misses, 1, __ATOMIC_RELAXED);
+            game = NULL;
+            break;
+        } else {
+            position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    /* Only the first taker to see the ring run low wakes the producer.
+     * The head is read first, so the tail read after is never behind */
+    position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&ring->tail, __ATOMIC_RELAXED) - position < BOARDS_LOW_WATERMARK){
+        boards_wake();
+    }
+
+    return game;
+}
+
+void boards_give(ms_game_t *game){
+
+    if (!boards_ring_of(game->config)){
+        free_game(game);
+        return;
+    }
+
+    game->next = __atomic_load_n(&boards_returned, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&boards_returned, (ms_game_t**)&game->next, game, true,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    boards_wake();
+}
+
+void boards_report(){
+
+    unsigned long hits, misses;
+    int i;
+
+    printf("\nBoard pool:");
+    for (i=0;i<BOARDS_RINGS;i++){
+        hits = __atomic_load_n(&boards_rings[i].hits, __ATOMIC_RELAXED);
+        misses = __atomic_load_n(&boards_rings[i].misses, __ATOMIC_RELAXED);
+        printf(" %s %lu of %lu ready (%.1f%%),", boards_rings[i].name, hits, hits+misses,
+            hits+misses ? 100.0*hits/(hits+misses) : 0.0);
+    }
+    printf(" %lu custom, %lu reused and %lu allocated\n", __atomic_load_n(&boards_unpooled, __ATOMIC_RELAXED),
+        __atomic_load_n(&boards_reused, __ATOMIC_RELAXED), __atomic_load_n(&boards_allocated, __ATOMIC_RELAXED));
+}
+
+/***********************************************************************
+ * func:            The loop of the producer thread. Sleeps until a
+ *                  ring runs low or boards are given back, then reuses
+ *                  the boards given back, and tops up every ring to the
+ *                  high watermark with new ones.
+***********************************************************************/
+void boards_loop(){
+
+    ms_board_ring_t *ring;
+    ms_game_t *game;
+    int i;
+
+    while (true){
+        pthread_mutex_lock(&boards_mutex);
+        while (!__atomic_load_n(&boards_wanted, __ATOMIC_SEQ_CST)){
+            pthread_cond_wait(&boards_cond, &boards_mutex);
+        }
+        __atomic_store_n(&boards_wanted, false, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&boards_mutex);
+
+        boards_reuse();
+
+        for (i=0;i<BOARDS_RINGS;i++){
+            ring = &boards_rings[i];
+            while (ring->tail - __atomic_load_n(&ring->head, __ATOMIC_RELAXED) < BOARDS_HIGH_WATERMARK){
+                game = new_game(rng_next(&boards_rng), ring->config);
+                if (!game){
+                    break;
+                }
+                if (!boards_put(ring, game)){
+                    free_game(game);
+                    break;
+                }
+                __atomic_fetch_add(&boards_allocated, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Takes every board given back, and clears and
+ *                  reseeds each into the ring of its difficulty. Boards
+ *                  that do not fit are freed. Only called by the
+ *                  producer.
+***********************************************************************/
+void boards_reuse(){
+
+    ms_game_t *game = __atomic_exchange_n(&boards_returned, NULL, __ATOMIC_ACQUIRE);
+    ms_game_t *next;
+    ms_board_ring_t *ring;
+
+    for (;game!=NULL;game=next){
+        next = game->next;
+        ring = boards_ring_of(game->config);
+
+        /* A no-guess game goes back as a classic one */
+        game->config = ring->config;
+        reset_game(game, rng_next(&boards_rng));
+
+        if (boards_put(ring, game)){
+            __atomic_fetch_add(&boards_reused, 1, __ATOMIC_RELAXED);
+        } else {
+            free_game(game);
+        }
+    }
+}
+
+/***********************************************************************
+ * func:            Wakes the producer, unless it has already been woken
+ *                  since it last started work.
+***********************************************************************/
+void boards_wake(){
+    if (!__atomic_exchange_n(&boards_wanted, true, __ATOMIC_SEQ_CST)){
+        pthread_mutex_lock(&boards_mutex);
+        pthread_cond_signal(&boards_cond);
+        pthread_mutex_unlock(&boards_mutex);
+    }
+}
+
+/***********************************************************************
+ * func:            Returns the ring kept for the difficulty of a given
+ *                  configuration, or NULL if it is not kept.
+ * param config:    The configuration of the board.
+***********************************************************************/
+ms_board_ring_t* boards_ring_of(ms_config_t config){
+
+    int i;
+
+    for (i=0;i<BOARDS_RINGS;i++){
+        if (boards_rings[i].config.cols == config.cols && boards_rings[i].config.rows == config.rows &&
+                boards_rings[i].config.bombs == config.bombs){
+            return &boards_rings[i];
+        }
+    }
+
+    return NULL;
+}
+
+/***********************************************************************
+ * func:            Adds a board at the tail of a ring. Only called by
+ *                  the producer. Returns false if the ring is full.
+ * param ring:      The ring to add to.
+ * param game:      The board to add.
+***********************************************************************/
+bool boards_put(ms_board_ring_t *ring, ms_game_t *game){
+
+    ms_board_slot_t *slot = &ring->slots[ring->tail & (BOARDS_RING_SIZE-1)];
+
+    /* The slot is free once the taker of the last pass has let it go */
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != ring->tail){
+        return false;
+    }
+
+    slot->game = game;
+    __atomic_store_n(&slot->sequence, ring->tail + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+/***********************************************************************
+ * func:            Initializes an empty ring.
+ * param ring:      The ring to initialize.
+ * param name:      The name of the difficulty, for reports.
+ * param config:    The configuration of its boards.
+***********************************************************************/
+void boards_ring_init(ms_board_ring_t *ring, const char *name, ms_config_t config){
+
+    int i;
+
+    ring->name = name;
+    ring->config = config;
+    ring->head = 0;
+    ring->tail = 0;
+
+    for (i=0;i<BOARDS_RING_SIZE;i++){
+        ring->slots[i].sequence = i;
+        ring->slots[i].game = NULL;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef BOARDS_H_
+#define BOARDS_H_
+
+#include <stdint.h>
+
+/* Minesweeper definitions */
+#include "ms.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Boards each ring can hold, a power of two */
+#define BOARDS_RING_SIZE 128
+
+/* Once a ring holds fewer boards than the low watermark, the producer
+ * refills it up to the high watermark */
+#define BOARDS_LOW_WATERMARK 32
+#define BOARDS_HIGH_WATERMARK BOARDS_RING_SIZE
+
+/***********************************************************************
+ * func:            Starts the thread that keeps a ring of ready made
+ *                  boards for each of the beginner, intermediate and
+ *                  expert difficulties. Bombs are placed at the first
+ *                  reveal, so a ready made board is an empty one, and
+ *                  the rings are mostly refilled with boards given back
+ *                  once their games end. Those are cleared and reseeded
+ *                  on the producer thread, so neither allocating nor
+ *                  clearing a board happens while a request waits.
+ * param seed:      The seed the boards are generated from.
+***********************************************************************/
+void boards_start(uint64_t seed);
+
+/***********************************************************************
+ * func:            Takes a ready made board of a given configuration
+ *                  without locking. Returns NULL if the configuration
+ *                  is not one of the difficulties kept, or its ring is
+ *                  empty, in which case the caller makes its own.
+ * param config:    The dimensions and bomb count of the board.
+***********************************************************************/
+ms_game_t* boards_take(ms_config_t config);
+
+/***********************************************************************
+ * func:            Gives back a board whose game is over. Boards of a
+ *                  difficulty that is kept are pushed without locking
+ *                  for the producer to reuse, and any others are freed.
+ * param game:      The board to give back.
+***********************************************************************/
+void boards_give(ms_game_t *game);
+
+/***********************************************************************
+ * func:            Prints how many boards were taken from each ring,
+ *                  how often a ring was found empty, and how many of
+ *                  the boards made were reused.
+***********************************************************************/
+void boards_report();
+
+#endif /* BOARDS_H_ */
@@ -0,0 +1,141 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Epoch definitions */
+#include "epoch.h"
+
+/* A struct representing the reading state of a single thread. Its
+ * state holds the epoch it entered in, shifted up, and whether it is
+ * currently reading in the lowest bit. Records live as long as the
+ * process, as the server never stops its threads */
+typedef struct ms_epoch_record ms_epoch_record_t;
+struct ms_epoch_record{
+    unsigned long state;
+    ms_epoch_record_t *next;
+};
+
+/* A struct representing memory waiting to be freed */
+typedef struct ms_epoch_retired ms_epoch_retired_t;
+struct ms_epoch_retired{
+    void *ptr;
+    epoch_free_t free_fn;
+    unsigned long epoch;            /* Epoch it was retired in */
+    ms_epoch_retired_t *next;
+};
+
+/* The current epoch, and the records of every thread that has read */
+unsigned long epoch_global = 0;
+ms_epoch_record_t *epoch_records = NULL;
+
+/* The record of the current thread */
+__thread ms_epoch_record_t *epoch_self = NULL;
+
+/* Memory waiting to be freed, oldest last */
+ms_epoch_retired_t *epoch_retired = NULL;
+pthread_mutex_t epoch_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Function definitions */
+bool epoch_try_advance();
+
+void epoch_enter(){
+
+    ms_epoch_record_t *record = epoch_self;
+
+    if (!record){
+        record = calloc(1, sizeof(ms_epoch_record_t));
+        if (!record){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+
+        record->next = __atomic_load_n(&epoch_records, __ATOMIC_SEQ_CST);
+        while (!__atomic_compare_exchange_n(&epoch_records, &record->next, record, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+        epoch_self = record;
+    }
+
+    /* Sequentially consistent, so any pointer loaded after this either
+     * predates an advance that has seen this thread reading, or is the
+     * newly published one */
+    __atomic_store_n(&record->state, (__atomic_load_n(&epoch_global, __ATOMIC_SEQ_CST) << 1) | 1, __ATOMIC_SEQ_CST);
+}
+
+void epoch_exit(){
+    __atomic_store_n(&epoch_self->state, 0, __ATOMIC_SEQ_CST);
+}
+
+void epoch_retire(void *ptr, epoch_free_t free_fn){
+
+    ms_epoch_retired_t *retired = malloc(sizeof(ms_epoch_retired_t));
+    ms_epoch_retired_t **link;
+    unsigned long epoch;
+
+    pthread_mutex_lock(&epoch_mutex);
+
+    if (retired){
+        retired->ptr = ptr;
+        retired->free_fn = free_fn;
+        retired->epoch = __atomic_load_n(&epoch_global, __ATOMIC_SEQ_CST);
+        retired->next = epoch_retired;
+        epoch_retired = retired;
+    }
+
+    /* Memory retired just now can be freed at once if no thread is
+     * reading, which takes two advances */
+    if (epoch_try_advance()){
+        epoch_try_advance();
+    }
+    epoch = __atomic_load_n(&epoch_global, __ATOMIC_SEQ_CST);
+
+    /* Once the epoch has moved on twice, every thread reading when the
+     * memory was retired has since stopped */
+    for (link=&epoch_retired;*link!=NULL;){
+        if ((*link)->epoch + 2 <= epoch){
+            ms_epoch_retired_t *done = *link;
+            *link = done->next;
+            done->free_fn(done->ptr);
+            free(done);
+        } else {
+            link = &(*link)->next;
+        }
+    }
+
+    pthread_mutex_unlock(&epoch_mutex);
+
+    /* Without memory to track it, wait out the readers here instead */
+    if (!retired){
+        epoch = __atomic_load_n(&epoch_global, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&epoch_global, __ATOMIC_SEQ_CST) < epoch + 2){
+            pthread_mutex_lock(&epoch_mutex);
+            epoch_try_advance();
+            pthread_mutex_unlock(&epoch_mutex);
+        }
+        free_fn(ptr);
+    }
+}
+
+/***********************************************************************
+ * func:            Moves to the next epoch if every thread currently
+ *                  reading entered in the current one. Returns whether
+ *                  the epoch moved. Called with epoch_mutex held.
+***********************************************************************/
+bool epoch_try_advance(){
+
+    unsigned long epoch = __atomic_load_n(&epoch_global, __ATOMIC_SEQ_CST);
+    unsigned long state;
+    ms_epoch_record_t *record;
+
+    for (record=__atomic_load_n(&epoch_records, __ATOMIC_SEQ_CST);record!=NULL;record=record->next){
+        state = __atomic_load_n(&record->state, __ATOMIC_SEQ_CST);
+        if ((state & 1) && (state >> 1) != epoch){
+            return false;
+        }
+    }
+
+    __atomic_store_n(&epoch_global, epoch + 1, __ATOMIC_SEQ_CST);
+
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+/* Function called to free memory retired with epoch_retire */
+typedef void (*epoch_free_t)(void *ptr);
+
+/***********************************************************************
+ * func:            Marks the calling thread as reading shared data
+ *                  published through atomic pointers. Anything it
+ *                  loads from such a pointer stays valid until it
+ *                  calls epoch_exit. Calls must not be nested.
+***********************************************************************/
+void epoch_enter();
+
+/***********************************************************************
+ * func:            Marks the calling thread as no longer reading
+ *                  shared data.
+***********************************************************************/
+void epoch_exit();
+
+/***********************************************************************
+ * func:            Frees memory once no thread can still be reading
+ *                  it. The memory must already be unreachable from
+ *                  any published pointer. Memory retired earlier is
+ *                  freed here once it is safe to.
+ * param ptr:       The memory to free.
+ * param free_fn:   The function that frees it.
+***********************************************************************/
+void epoch_retire(void *ptr, epoch_free_t free_fn);
+
+#endif /* EPOCH_H_ */
@@ -0,0 +1,337 @@
+#define _GNU_SOURCE
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Generator definitions */
+#include "generator.h"
+/* Minesweeper definitions */
+#include "ms.h"
+/* Compute pool definitions */
+#include "pool.h"
+/* Solver definitions */
+#include "solver.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Sizes of board the statistics are kept for, the last being custom */
+#define GENERATOR_SIZES 4
+
+/* A struct representing a search for a single no-guess board, shared
+ * by every job taking part. Attempts are claimed in order, and an
+ * attempt is abandoned once an earlier one has succeeded */
+typedef struct{
+    ms_config_t config;
+    uint64_t seed;
+    int x;
+    int y;
+    struct timespec deadline;
+    unsigned long next;             /* The next attempt to claim */
+    unsigned long found;            /* The first attempt that succeeded */
+    int running;                    /* Attempts claimed and not finished */
+    int references;                 /* Jobs yet to finish with the search */
+    pthread_mutex_t mutex;
+    pthread_cond_t finished;
+} ms_generation_t;
+
+/* Struct of a job helping with a search on another worker */
+typedef struct{
+    ms_job_t job;
+    ms_generation_t *generation;
+} ms_generator_job_t;
+
+/* Struct of the argument of the solver cancel function */
+typedef struct{
+    ms_generation_t *generation;
+    unsigned long attempt;
+} ms_attempt_t;
+
+/* A struct representing the statistics of a single size of board. The
+ * time is that spent on attempts by every worker, in nanoseconds */
+typedef struct{
+    const char *name;
+    unsigned long boards;
+    unsigned long failures;
+    unsigned long attempts;
+    unsigned long nanoseconds;
+} ms_generator_stats_t;
+
+ms_generator_stats_t generator_stats[GENERATOR_SIZES] = {
+    {"beginner", 0, 0, 0, 0},
+    {"intermediate", 0, 0, 0, 0},
+    {"expert", 0, 0, 0, 0},
+    {"custom", 0, 0, 0, 0}
+};
+
+/* Function definitions */
+void generator_attempts(ms_generation_t *generation);
+void generator_job_run(ms_job_t *job);
+void generator_release(ms_generation_t *generation);
+
+bool generator_attempt(ms_generation_t *generation, unsigned long attempt);
+bool generator_cancelled(void *arg);
+bool generator_expired(ms_generation_t *generation);
+
+unsigned long generator_search(ms_config_t config, uint64_t seed, int x, int y, unsigned long *tried);
+
+ms_generator_stats_t* generator_stats_of(ms_config_t config);
+
+uint64_t generator_find(ms_config_t *config, uint64_t seed, int x, int y){
+
+    ms_generator_stats_t *stats = generator_stats_of(*config);
+    unsigned long found, tried;
+
+    while ((found = generator_search(*config, seed, x, y, &tried)) == ULONG_MAX){
+        __atomic_fetch_add(&stats->failures, 1, __ATOMIC_RELAXED);
+
+        /* Carry on from the seeds already tried, with fewer bombs to
+         * leave fewer places a guess could be needed. A single bomb
+         * is left at the least, which is nearly always cleared by the
+         * first reveal alone */
+        seed += tried;
+        if (config->bombs > 1){
+            config->bombs -= (config->bombs+3)/4;
+        }
+    }
+
+    __atomic_fetch_add(&stats->boards, 1, __ATOMIC_RELAXED);
+    return seed + found;
+}
+
+/***********************************************************************
+ * func:            Searches for a no-guess board until one is found or
+ *                  GENERATOR_TIMEOUT has passed. Returns the attempt
+ *                  that succeeded, added to the seed, or ULONG_MAX if
+ *                  none did.
+ * param config:    The dimensions and bomb count of the board.
+ * param seed:      The seed to try first.
+ * param x:         The x location of the first reveal.
+ * param y:         The y location of the first reveal.
+ * param tried:     Set to the number of attempts claimed.
+***********************************************************************/
+unsigned long generator_search(ms_config_t config, uint64_t seed, int x, int y, unsigned long *tried){
+
+    ms_generation_t *generation = malloc(sizeof(ms_generation_t));
+    ms_generator_job_t *job;
+    unsigned long found;
+    int helpers = pool_background_count() - 1;
+    int i;
+
+    if (!generation){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    generation->config = config;
+    generation->seed = seed;
+    generation->x = x;
+    generation->y = y;
+    generation->next = 0;
+    generation->found = ULONG_MAX;
+    generation->running = 0;
+    generation->references = helpers + 1;
+    pthread_mutex_init(&generation->mutex, NULL);
+    pthread_cond_init(&generation->finished, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &generation->deadline);
+    generation->deadline.tv_sec += GENERATOR_TIMEOUT;
+
+    /* Every other background worker joins in, if it is not busy */
+    for (i=0;i<helpers;i++){
+        job = calloc(1, sizeof(ms_generator_job_t));
+        if (!job){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+        job->job.run = generator_job_run;
+        job->generation = generation;
+        pool_submit_background(&job->job);
+    }
+
+    generator_attempts(generation);
+
+    /* Attempts claimed before the one that succeeded may still win */
+    pthread_mutex_lock(&generation->mutex);
+    while (generation->running > 0){
+        pthread_cond_wait(&generation->finished, &generation->mutex);
+    }
+    found = generation->found;
+    *tried = generation->next;
+    pthread_mutex_unlock(&generation->mutex);
+
+    generator_release(generation);
+
+    return found;
+}
+
+void generator_report(){
+
+    ms_generator_stats_t *stats;
+    double seconds;
+    int i;
+
+    printf("\nNo-guess boards:");
+    for (i=0;i<GENERATOR_SIZES;i++){
+        stats = &generator_stats[i];
+        seconds = __atomic_load_n(&stats->nanoseconds, __ATOMIC_RELAXED) / 1e9;
+        printf(" %s %lu from %lu attempts (%.1f per second per core, %lu searches relaxed)%s", stats->name,
+            __atomic_load_n(&stats->boards, __ATOMIC_RELAXED),
+            __atomic_load_n(&stats->attempts, __ATOMIC_RELAXED),
+            seconds > 0 ? __atomic_load_n(&stats->boards, __ATOMIC_RELAXED) / seconds : 0.0,
+            __atomic_load_n(&stats->failures, __ATOMIC_RELAXED),
+            i < GENERATOR_SIZES-1 ? "," : "\n");
+    }
+}
+
+/***********************************************************************
+ * func:            Claims and makes attempts at a search until one has
+ *                  succeeded, or the search has timed out.
+ * param generation: The search to take part in.
+***********************************************************************/
+void generator_attempts(ms_generation_t *generation){
+
+    ms_generator_stats_t *stats = generator_stats_of(generation->config);
+    struct timespec start, end;
+    unsigned long attempt;
+    bool success;
+
+    while (!generator_expired(generation)){
+
+        /* Count the attempt as running before claiming it, so it is
+         * waited for if it could still come first */
+        __atomic_fetch_add(&generation->running, 1, __ATOMIC_SEQ_CST);
+        attempt = __atomic_fetch_add(&generation->next, 1, __ATOMIC_SEQ_CST);
+
+        success = false;
+        if (attempt < __atomic_load_n(&generation->found, __ATOMIC_SEQ_CST)){
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+            success = generator_attempt(generation, attempt);
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+
+            __atomic_fetch_add(&stats->attempts, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&stats->nanoseconds,
+                (end.tv_sec - start.tv_sec)*1000000000L + end.tv_nsec - start.tv_nsec, __ATOMIC_RELAXED);
+        } else {
+            attempt = ULONG_MAX;
+        }
+
+        pthread_mutex_lock(&generation->mutex);
+        if (success && attempt < generation->found){
+            __atomic_store_n(&generation->found, attempt, __ATOMIC_SEQ_CST);
+        }
+        if (__atomic_sub_fetch(&generation->running, 1, __ATOMIC_SEQ_CST) == 0){
+            pthread_cond_broadcast(&generation->finished);
+        }
+        pthread_mutex_unlock(&generation->mutex);
+
+        /* Every attempt from here on comes after the one found */
+        if (attempt == ULONG_MAX || success){
+            break;
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Makes a single attempt at a search, generating its
+ *                  board and playing it with the solver. Returns true
+ *                  if the solver cleared it.
+ * param generation: The search the attempt is part of.
+ * param attempt:   The number of the attempt, added to the seed.
+***********************************************************************/
+bool generator_attempt(ms_generation_t *generation, unsigned long attempt){
+
+    ms_attempt_t arg = {generation, attempt};
+    ms_game_t *game = new_game(generation->seed + attempt, generation->config);
+    req_t result;
+
+    if (!game){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    result = reveal_tile(game, generation->x, generation->y);
+    if (result == valid){
+        result = solver_clear(game, generator_cancelled, &arg);
+    }
+
+    free_game(game);
+
+    return result == won;
+}
+
+/***********************************************************************
+ * func:            The cancel function given to the solver. An attempt
+ *                  is cancelled once an earlier one has succeeded, or
+ *                  the search has timed out.
+ * param arg:       The attempt being made.
+***********************************************************************/
+bool generator_cancelled(void *arg){
+    ms_attempt_t *attempt = arg;
+    return __atomic_load_n(&attempt->generation->found, __ATOMIC_RELAXED) < attempt->attempt ||
+        generator_expired(attempt->generation);
+}
+
+/***********************************************************************
+ * func:            Returns true if a search has run past its deadline.
+ * param generation: The search to check.
+***********************************************************************/
+bool generator_expired(ms_generation_t *generation){
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec > generation->deadline.tv_sec ||
+        (now.tv_sec == generation->deadline.tv_sec && now.tv_nsec >= generation->deadline.tv_nsec);
+}
+
+/***********************************************************************
+ * func:            The run function of a job helping with a search.
+ * param job:       The job to run.
+***********************************************************************/
+void generator_job_run(ms_job_t *job){
+
+    ms_generation_t *generation = ((ms_generator_job_t*)job)->generation;
+
+    free(job);
+
+    generator_attempts(generation);
+    generator_release(generation);
+}
+
+/***********************************************************************
+ * func:            Lets go of a search, freeing it once every job
+ *                  taking part has.
+ * param generation: The search to let go of.
+***********************************************************************/
+void generator_release(ms_generation_t *generation){
+    if (__atomic_sub_fetch(&generation->references, 1, __ATOMIC_SEQ_CST) == 0){
+        pthread_mutex_destroy(&generation->mutex);
+        pthread_cond_destroy(&generation->finished);
+        free(generation);
+    }
+}
+
+/***********************************************************************
+ * func:            Returns the statistics kept for the size of board
+ *                  of a given configuration.
+ * param config:    The configuration of the board.
+***********************************************************************/
+ms_generator_stats_t* generator_stats_of(ms_config_t config){
+
+    ms_config_t sizes[GENERATOR_SIZES-1] = {MS_BEGINNER, MS_INTERMEDIATE, MS_EXPERT};
+    int i;
+
+    for (i=0;i<GENERATOR_SIZES-1;i++){
+        if (sizes[i].cols == config.cols && sizes[i].rows == config.rows && sizes[i].bombs == config.bombs){
+            return &generator_stats[i];
+        }
+    }
+
+    return &generator_stats[GENERATOR_SIZES-1];
+}
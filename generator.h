@@ -0,0 +1,39 @@
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <stdint.h>
+
+/* Utility definitions */
+#include "utils.h"
+
+/* Seconds spent looking for a no-guess board before looking again with
+ * fewer bombs */
+#define GENERATOR_TIMEOUT 2
+
+/***********************************************************************
+ * func:            Finds the seed of a board that the solver can clear
+ *                  without guessing from a given first reveal. Seeds
+ *                  are tried in turn from a given seed, on every
+ *                  background worker at once, and the first that works is
+ *                  returned, so the result does not depend on how the
+ *                  attempts were spread. Attempts after one that works
+ *                  are cancelled. Each time none is found within
+ *                  GENERATOR_TIMEOUT, the bomb count of the config is
+ *                  lowered and the search goes on, so a no-guess board
+ *                  is always returned.
+ * param config:    The dimensions and bomb count of the board, which
+ *                  is left holding the bomb count of the board found.
+ * param seed:      The seed to try first.
+ * param x:         The x location of the first reveal.
+ * param y:         The y location of the first reveal.
+***********************************************************************/
+uint64_t generator_find(ms_config_t *config, uint64_t seed, int x, int y);
+
+/***********************************************************************
+ * func:            Prints how many no-guess boards were found for
+ *                  each size of board, and how many boards per second
+ *                  each core could find.
+***********************************************************************/
+void generator_report();
+
+#endif /* GENERATOR_H_ */
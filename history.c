@@ -0,0 +1,83 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* History definitions */
+#include "history.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Function definitions */
+void history_grow(ms_history_table_t *table);
+
+int history_init(ms_history_table_t *table){
+
+    table->buckets = calloc(HISTORY_INITIAL_BUCKETS, sizeof(ms_user_history_t*));
+    if (!table->buckets){
+        return ERROR;
+    }
+
+    table->mask = HISTORY_INITIAL_BUCKETS-1;
+    table->count = 0;
+
+    return 0;
+}
+
+ms_user_history_t* history_find(ms_history_table_t *table, const char *username){
+
+    uint64_t hash = hash_string(username);
+    ms_user_history_t *history;
+
+    for (history=table->buckets[hash & table->mask];history!=NULL;history=history->next){
+        if (history->hash == hash && strcmp(history->username, username) == 0){
+            return history;
+        }
+    }
+
+    history = calloc(1, sizeof(ms_user_history_t));
+    if (!history){
+        return NULL;
+    }
+
+    snprintf(history->username, MAX_USERNAME_LEN, "%s", username);
+    history->hash = hash;
+    history->next = table->buckets[hash & table->mask];
+    table->buckets[hash & table->mask] = history;
+
+    if (++table->count > table->mask+1){
+        history_grow(table);
+    }
+
+    return history;
+}
+
+/***********************************************************************
+ * func:            Doubles the buckets of a table, moving each history
+ *                  to its new bucket. The histories themselves stay
+ *                  where they are. If the system has run out of memory
+ *                  the table keeps its buckets, and chains grow longer.
+ * param table:     The table to grow.
+***********************************************************************/
+void history_grow(ms_history_table_t *table){
+
+    size_t size = (table->mask+1)*2, i;
+    ms_user_history_t **buckets = calloc(size, sizeof(ms_user_history_t*));
+    ms_user_history_t *history, *next;
+
+    if (!buckets){
+        return;
+    }
+
+    for (i=0;i<=table->mask;i++){
+        for (history=table->buckets[i];history!=NULL;history=next){
+            next = history->next;
+            history->next = buckets[history->hash & (size-1)];
+            buckets[history->hash & (size-1)] = history;
+        }
+    }
+
+    free(table->buckets);
+    table->buckets = buckets;
+    table->mask = size-1;
+}
@@ -0,0 +1,52 @@
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Utility definitions */
+#include "utils.h"
+
+/* Buckets a new history table starts with, a power of two */
+#define HISTORY_INITIAL_BUCKETS 64
+
+/* A struct representing the games won and lost by a single user, and
+ * their best entry on the leaderboard, NULL until they have won. A
+ * history never moves once created, so it can be pointed to directly */
+typedef struct ms_user_history ms_user_history_t;
+struct ms_user_history{
+    int won;
+    int lost;
+    char username[MAX_USERNAME_LEN];
+    struct ms_leader *best;
+    uint64_t hash;                  /* Hash of the username */
+    uint32_t index;                 /* Position in the last saved copy */
+    ms_user_history_t *next;        /* Next history in the same bucket */
+};
+
+/* A struct representing a chained hash table of user histories, keyed
+ * by username. It doubles in size whenever it holds more histories
+ * than buckets */
+typedef struct{
+    ms_user_history_t **buckets;
+    size_t mask;                    /* Number of buckets minus one */
+    size_t count;
+} ms_history_table_t;
+
+/***********************************************************************
+ * func:            Initializes an empty history table. Returns ERROR
+ *                  if the system has run out of memory.
+ * param table:     The table to initialize.
+***********************************************************************/
+int history_init(ms_history_table_t *table);
+
+/***********************************************************************
+ * func:            Returns the history of a given user in O(1),
+ *                  creating an empty one if they have none. Returns
+ *                  NULL if the system has run out of memory.
+ * param table:     The table to search.
+ * param username:  The username of the user.
+***********************************************************************/
+ms_user_history_t* history_find(ms_history_table_t *table, const char *username);
+
+#endif /* HISTORY_H_ */
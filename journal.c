@@ -0,0 +1,543 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Journal definitions */
+#include "journal.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Values identifying the files of the journal */
+#define JOURNAL_LOG_MAGIC 0x4D534C4F47000001ULL
+#define JOURNAL_SNAPSHOT_MAGIC 0x4D53534E41500001ULL
+
+/* Longest path of a journal file */
+#define JOURNAL_PATH_LEN 256
+
+/* A struct representing the start of a log. Logs are numbered by
+ * generation, and a new one is started with each snapshot */
+typedef struct{
+    uint64_t magic;
+    uint64_t generation;
+} ms_journal_log_t;
+
+/* A struct representing the start of a snapshot. It holds the state
+ * reached by every log before its generation */
+typedef struct{
+    uint64_t magic;
+    uint64_t generation;            /* First log not in the snapshot */
+    uint64_t len;                   /* Length of the body that follows */
+    uint32_t checksum;              /* CRC-32 of the body */
+    uint32_t reserved;
+} ms_journal_snapshot_t;
+
+/* The name of the saved state, and the log currently written to */
+const char *journal_name = NULL;
+int journal_fd = ERROR;
+uint64_t journal_generation = 0;
+off_t journal_offset = 0;
+
+/* Records added but not yet written. Once a snapshot is taken, sealed
+ * holds the records still to be written to the log it replaces */
+ms_buffer_t journal_pending;
+ms_buffer_t journal_sealed;
+
+/* The snapshot waiting to be written, if any */
+ms_buffer_t journal_image;
+bool journal_image_ready = false;
+
+/* Records added since the last snapshot, and whether one is due but
+ * not yet written */
+size_t journal_records = 0;
+bool journal_saving = false;
+
+bool journal_stopping = false;
+bool journal_stopped = false;
+
+pthread_mutex_t journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t journal_cond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t journal_stopped_cond = PTHREAD_COND_INITIALIZER;
+
+/* Function definitions */
+void journal_loop();
+void journal_path(char *path, const char *suffix, uint64_t generation);
+void journal_save(ms_buffer_t *body);
+void journal_sync_dir();
+void journal_write(const void *data, size_t len);
+
+bool journal_load(journal_load_t load);
+
+int journal_open_log(uint64_t generation);
+
+size_t journal_replay(uint64_t generation, journal_replay_t replay);
+
+int journal_start(const char *name, journal_load_t load, journal_replay_t replay){
+
+    struct timespec started, finished;
+    pthread_t thread;
+    char path[JOURNAL_PATH_LEN];
+    size_t replayed = 0;
+    uint64_t generation;
+    bool loaded;
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    journal_name = name;
+
+    loaded = journal_load(load);
+
+    /* Logs older than the snapshot are left behind if the server
+     * stopped before removing them */
+    for (generation=journal_generation;generation>0;generation--){
+        journal_path(path, "log", generation-1);
+        if (unlink(path) == ERROR){
+            break;
+        }
+    }
+
+    /* Replay every log written since, continuing in the last one */
+    for (generation=journal_generation;;generation++){
+        journal_path(path, "log", generation);
+        if (access(path, F_OK) == ERROR){
+            break;
+        }
+        journal_generation = generation;
+        replayed += journal_replay(generation, replay);
+    }
+
+    journal_fd = journal_open_log(journal_generation);
+    if (journal_fd == ERROR){
+        return ERROR;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    printf("Recovered %s%zu logged games in %.1fms\n", loaded ? "a snapshot and " : "", replayed,
+        (finished.tv_sec - started.tv_sec)*1e3 + (finished.tv_nsec - started.tv_nsec)/1e6);
+
+    /* Replayed records count towards the next snapshot */
+    journal_records = replayed;
+
+    pthread_create(&thread, NULL, (void*) journal_loop, NULL);
+    pthread_detach(thread);
+
+    return 0;
+}
+
+bool journal_append(req_t outcome, int seconds, const char *username){
+
+    ms_journal_record_t record;
+    bool due = false;
+
+    memset(&record, 0, sizeof(ms_journal_record_t));
+    record.outcome = outcome;
+    record.seconds_taken = seconds;
+    snprintf(record.username, MAX_USERNAME_LEN, "%s", username);
+    record.checksum = checksum((char*)&record + sizeof(uint32_t), sizeof(ms_journal_record_t) - sizeof(uint32_t));
+
+    pthread_mutex_lock(&journal_mutex);
+
+    /* The first record of a batch wakes the journal thread */
+    if (journal_pending.len == 0){
+        pthread_cond_signal(&journal_cond);
+    }
+    buffer_append(&journal_pending, &record, sizeof(ms_journal_record_t));
+
+    if (++journal_records >= JOURNAL_SNAPSHOT_RECORDS && !journal_saving){
+        journal_saving = true;
+        due = true;
+    }
+
+    pthread_mutex_unlock(&journal_mutex);
+
+    return due;
+}
+
+void journal_snapshot(ms_buffer_t *body){
+
+    pthread_mutex_lock(&journal_mutex);
+
+    /* Records added from now on go to the next log */
+    journal_sealed = journal_pending;
+    memset(&journal_pending, 0, sizeof(ms_buffer_t));
+
+    journal_image = *body;
+    memset(body, 0, sizeof(ms_buffer_t));
+    journal_image_ready = true;
+    journal_records = 0;
+
+    pthread_cond_signal(&journal_cond);
+
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+void journal_stop(){
+
+    pthread_mutex_lock(&journal_mutex);
+
+    journal_stopping = true;
+    pthread_cond_signal(&journal_cond);
+
+    while (!journal_stopped && journal_fd != ERROR){
+        pthread_cond_wait(&journal_stopped_cond, &journal_mutex);
+    }
+
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+/***********************************************************************
+ * func:            The loop of the journal thread. Waits for records,
+ *                  gathers any more added within the commit interval,
+ *                  then writes and syncs them all at once. Snapshots
+ *                  are written here too, so files are only ever
+ *                  written by this thread.
+***********************************************************************/
+void journal_loop(){
+
+    ms_buffer_t batch, sealed, image;
+    bool rotate, rotated, stop;
+
+    pthread_mutex_lock(&journal_mutex);
+
+    while (true){
+        while (journal_pending.len == 0 && !journal_image_ready && !journal_stopping){
+            pthread_cond_wait(&journal_cond, &journal_mutex);
+        }
+
+        /* Let the rest of the group arrive */
+        if (!journal_stopping){
+            pthread_mutex_unlock(&journal_mutex);
+            usleep(JOURNAL_COMMIT_INTERVAL*1000);
+            pthread_mutex_lock(&journal_mutex);
+        }
+
+        batch = journal_pending;
+        memset(&journal_pending, 0, sizeof(ms_buffer_t));
+
+        rotate = journal_image_ready;
+        if (rotate){
+            sealed = journal_sealed;
+            image = journal_image;
+            memset(&journal_sealed, 0, sizeof(ms_buffer_t));
+            memset(&journal_image, 0, sizeof(ms_buffer_t));
+            journal_image_ready = false;
+        }
+
+        stop = journal_stopping;
+
+        pthread_mutex_unlock(&journal_mutex);
+
+        /* Finish the log the snapshot replaces, and start the next */
+        rotated = false;
+        if (rotate){
+            journal_write(sealed.data, sealed.len);
+            fsync(journal_fd);
+            buffer_free(&sealed);
+
+            int fd = journal_open_log(journal_generation+1);
+            if (fd != ERROR){
+                close(journal_fd);
+                journal_fd = fd;
+                journal_generation++;
+                rotated = true;
+            }
+        }
+
+        if (batch.len){
+            journal_write(batch.data, batch.len);
+            fdatasync(journal_fd);
+        }
+        buffer_free(&batch);
+
+        /* If no new log could be started, the snapshot cannot be told
+         * apart from the records that follow it, so it is dropped */
+        if (rotate){
+            if (rotated){
+                journal_save(&image);
+            }
+            buffer_free(&image);
+        }
+
+        pthread_mutex_lock(&journal_mutex);
+
+        if (rotate){
+            journal_saving = false;
+        }
+
+        if (stop){
+            journal_stopped = true;
+            pthread_cond_broadcast(&journal_stopped_cond);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+/***********************************************************************
+ * func:            Writes a snapshot holding every log before the
+ *                  current one, then removes those logs. The snapshot
+ *                  is written beside the old one and renamed over it,
+ *                  so either one or the other is always whole.
+ * param body:      The serialized state.
+***********************************************************************/
+void journal_save(ms_buffer_t *body){
+
+    ms_journal_snapshot_t header;
+    char path[JOURNAL_PATH_LEN], temporary[JOURNAL_PATH_LEN];
+    uint64_t generation;
+    int fd;
+
+    memset(&header, 0, sizeof(ms_journal_snapshot_t));
+    header.magic = JOURNAL_SNAPSHOT_MAGIC;
+    header.generation = journal_generation;
+    header.len = body->len;
+    header.checksum = checksum(body->data, body->len);
+
+    journal_path(path, "snapshot", 0);
+    journal_path(temporary, "snapshot.tmp", 0);
+
+    if ((fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == ERROR){
+        perror("Saving snapshot");
+        return;
+    }
+
+    if (write(fd, &header, sizeof(ms_journal_snapshot_t)) != sizeof(ms_journal_snapshot_t) ||
+            (body->len && write(fd, body->data, body->len) != (ssize_t)body->len) ||
+            fsync(fd) == ERROR){
+        perror("Saving snapshot");
+        close(fd);
+        unlink(temporary);
+        return;
+    }
+    close(fd);
+
+    if (rename(temporary, path) == ERROR){
+        perror("Saving snapshot");
+        unlink(temporary);
+        return;
+    }
+    journal_sync_dir();
+
+    for (generation=journal_generation;generation>0;generation--){
+        journal_path(path, "log", generation-1);
+        if (unlink(path) == ERROR){
+            break;
+        }
+    }
+}
+
+/***********************************************************************
+ * func:            Loads the snapshot, if there is an undamaged one,
+ *                  and sets the generation of the first log to replay.
+ *                  Returns whether a snapshot was loaded.
+ * param load:      The function to load the snapshot with.
+***********************************************************************/
+bool journal_load(journal_load_t load){
+
+    ms_journal_snapshot_t *header;
+    struct stat status;
+    char path[JOURNAL_PATH_LEN];
+    const char *data;
+    bool loaded = false;
+    int fd;
+
+    journal_path(path, "snapshot", 0);
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == ERROR){
+        return false;
+    }
+
+    if (fstat(fd, &status) == ERROR || status.st_size < (off_t)sizeof(ms_journal_snapshot_t)){
+        close(fd);
+        return false;
+    }
+
+    data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED){
+        perror("Reading snapshot");
+        return false;
+    }
+
+    madvise((void*)data, status.st_size, MADV_SEQUENTIAL);
+
+    header = (ms_journal_snapshot_t*)data;
+    if (header->magic == JOURNAL_SNAPSHOT_MAGIC &&
+            header->len == status.st_size - sizeof(ms_journal_snapshot_t) &&
+            header->checksum == checksum(data + sizeof(ms_journal_snapshot_t), header->len)){
+        load(data + sizeof(ms_journal_snapshot_t), header->len);
+        journal_generation = header->generation;
+        loaded = true;
+    } else {
+        printf("Ignoring a damaged snapshot in %s\n", path);
+    }
+
+    munmap((void*)data, status.st_size);
+
+    return loaded;
+}
+
+/***********************************************************************
+ * func:            Replays the records of a given log, stopping at the
+ *                  first damaged or partly written one. Anything after
+ *                  it is cut from the log. Returns the records replayed.
+ * param generation: The generation of the log.
+ * param replay:    The function to apply each record with.
+***********************************************************************/
+size_t journal_replay(uint64_t generation, journal_replay_t replay){
+
+    ms_journal_log_t *header;
+    ms_journal_record_t *record;
+    struct stat status;
+    char path[JOURNAL_PATH_LEN];
+    const char *data;
+    size_t replayed = 0, offset = sizeof(ms_journal_log_t);
+    int fd;
+
+    journal_path(path, "log", generation);
+
+    if ((fd = open(path, O_RDWR | O_CLOEXEC)) == ERROR){
+        return 0;
+    }
+
+    if (fstat(fd, &status) == ERROR || status.st_size < (off_t)sizeof(ms_journal_log_t)){
+        close(fd);
+        return 0;
+    }
+
+    data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED){
+        perror("Reading log");
+        close(fd);
+        return 0;
+    }
+
+    madvise((void*)data, status.st_size, MADV_SEQUENTIAL);
+
+    header = (ms_journal_log_t*)data;
+    if (header->magic == JOURNAL_LOG_MAGIC && header->generation == generation){
+        for (;offset+sizeof(ms_journal_record_t)<=(size_t)status.st_size;offset+=sizeof(ms_journal_record_t)){
+            record = (ms_journal_record_t*)(data + offset);
+            if (record->checksum != checksum((char*)record + sizeof(uint32_t), sizeof(ms_journal_record_t) - sizeof(uint32_t))){
+                break;
+            }
+            replay(record);
+            replayed++;
+        }
+    }
+
+    munmap((void*)data, status.st_size);
+
+    if (offset < (size_t)status.st_size){
+        printf("Discarding %zu damaged bytes at the end of %s\n", (size_t)status.st_size - offset, path);
+        if (ftruncate(fd, offset) == ERROR){
+            perror("Truncating log");
+        }
+    }
+    close(fd);
+
+    return replayed;
+}
+
+/***********************************************************************
+ * func:            Opens a given log for new records, creating it if
+ *                  there is none. Returns the file descriptor, or ERROR.
+ * param generation: The generation of the log.
+***********************************************************************/
+int journal_open_log(uint64_t generation){
+
+    ms_journal_log_t header;
+    struct stat status;
+    char path[JOURNAL_PATH_LEN];
+    int fd;
+
+    journal_path(path, "log", generation);
+
+    if ((fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == ERROR || fstat(fd, &status) == ERROR){
+        perror("Opening log");
+        if (fd != ERROR){
+            close(fd);
+        }
+        return ERROR;
+    }
+
+    /* Replay left a whole log, so only a new one needs its header */
+    if (status.st_size < (off_t)sizeof(ms_journal_log_t)){
+        header.magic = JOURNAL_LOG_MAGIC;
+        header.generation = generation;
+        if (pwrite(fd, &header, sizeof(ms_journal_log_t), 0) != sizeof(ms_journal_log_t) || fsync(fd) == ERROR){
+            perror("Opening log");
+            close(fd);
+            return ERROR;
+        }
+        journal_sync_dir();
+        status.st_size = sizeof(ms_journal_log_t);
+    }
+
+    journal_offset = status.st_size;
+
+    return fd;
+}
+
+/***********************************************************************
+ * func:            Writes data to the end of the current log.
+ * param data:      The data to write.
+ * param len:       The length of the data.
+***********************************************************************/
+void journal_write(const void *data, size_t len){
+
+    ssize_t result;
+
+    while (len > 0){
+        result = pwrite(journal_fd, data, len, journal_offset);
+        if (result == ERROR){
+            if (errno == EINTR){
+                continue;
+            }
+            perror("Writing log");
+            return;
+        }
+        data = (const char*)data + result;
+        len -= result;
+        journal_offset += result;
+    }
+}
+
+/***********************************************************************
+ * func:            Syncs the working directory, so that files created
+ *                  or renamed in it survive a crash.
+***********************************************************************/
+void journal_sync_dir(){
+
+    int fd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd != ERROR){
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/***********************************************************************
+ * func:            Builds the path of a journal file.
+ * param path:      The buffer to build the path in.
+ * param suffix:    The end of the file name, or log for a log.
+ * param generation: The generation of the log.
+***********************************************************************/
+void journal_path(char *path, const char *suffix, uint64_t generation){
+    if (strcmp(suffix, "log") == 0){
+        snprintf(path, JOURNAL_PATH_LEN, "%s.%llu.log", journal_name, (unsigned long long)generation);
+    } else {
+        snprintf(path, JOURNAL_PATH_LEN, "%s.%s", journal_name, suffix);
+    }
+}
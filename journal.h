@@ -0,0 +1,77 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Utility definitions */
+#include "utils.h"
+
+/* Milliseconds the journal thread waits to gather records into a single
+ * write and sync of the log */
+#define JOURNAL_COMMIT_INTERVAL 10
+
+/* Records written to the logs before a new snapshot is due, which
+ * bounds the records replayed on startup */
+#define JOURNAL_SNAPSHOT_RECORDS 16384
+
+/* A struct representing a single finished game in the log. Records are
+ * a fixed size, so a damaged or partly written record is detected by
+ * its checksum alone */
+typedef struct{
+    uint32_t checksum;              /* CRC-32 of the rest of the record */
+    int32_t outcome;                /* Either won or lost */
+    int32_t seconds_taken;          /* Time taken, if the game was won */
+    char username[MAX_USERNAME_LEN];
+} ms_journal_record_t;
+
+/* Called on startup with the body of the last snapshot saved */
+typedef void (*journal_load_t)(const char *data, size_t len);
+
+/* Called on startup with each record logged after that snapshot */
+typedef void (*journal_replay_t)(ms_journal_record_t *record);
+
+/***********************************************************************
+ * func:            Recovers the state saved under a given name, from
+ *                  its last snapshot and the logs written after it,
+ *                  then starts the thread that writes new records.
+ *                  Files are kept in the working directory, as the
+ *                  name followed by .snapshot, and by the generation
+ *                  and .log for each log. Returns ERROR if the logs
+ *                  cannot be written.
+ * param name:      The name of the saved state.
+ * param load:      The function to load a snapshot with.
+ * param replay:    The function to apply a logged record with.
+***********************************************************************/
+int journal_start(const char *name, journal_load_t load, journal_replay_t replay);
+
+/***********************************************************************
+ * func:            Adds a finished game to the log. The record is
+ *                  written and synced along with every other record
+ *                  added within JOURNAL_COMMIT_INTERVAL, so callers
+ *                  never wait on the disk. Returns true when a snapshot
+ *                  is due, in which case the caller should pass one to
+ *                  journal_snapshot before adding the next record.
+ * param outcome:   Either won or lost.
+ * param seconds:   The time taken, if the game was won.
+ * param username:  The user who played the game.
+***********************************************************************/
+bool journal_append(req_t outcome, int seconds, const char *username);
+
+/***********************************************************************
+ * func:            Saves a snapshot of the state reached by every
+ *                  record added so far, then removes the logs it
+ *                  replaces. The snapshot is written by the journal
+ *                  thread, which takes ownership of the buffer.
+ * param body:      The serialized state.
+***********************************************************************/
+void journal_snapshot(ms_buffer_t *body);
+
+/***********************************************************************
+ * func:            Writes and syncs every record added so far, and
+ *                  stops the journal thread.
+***********************************************************************/
+void journal_stop();
+
+#endif /* JOURNAL_H_ */
@@ -0,0 +1,177 @@
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Leaderboard definitions */
+#include "leaderboard.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Function definitions */
+ms_leader_t* leaderboard_add(ms_leaderboard_t *board, ms_user_history_t *history, int seconds, int wins, bool last);
+
+int leaderboard_compare(int seconds, int wins, const char *name, ms_leader_t *leader);
+int leaderboard_random_level(ms_leaderboard_t *board);
+
+ms_leader_t* leaderboard_new_leader(int level);
+
+int leaderboard_init(ms_leaderboard_t *board){
+
+    int i;
+
+    board->head = leaderboard_new_leader(LEADERBOARD_MAX_LEVEL);
+    if (!board->head){
+        return ERROR;
+    }
+
+    for (i=0;i<LEADERBOARD_MAX_LEVEL;i++){
+        board->tail[i] = board->head;
+    }
+
+    board->level = 1;
+    board->length = 0;
+    board->random = 0x9E3779B97F4A7C15ULL;
+
+    return 0;
+}
+
+ms_leader_t* leaderboard_insert(ms_leaderboard_t *board, ms_user_history_t *history, int seconds, int wins){
+    return leaderboard_add(board, history, seconds, wins, false);
+}
+
+ms_leader_t* leaderboard_append(ms_leaderboard_t *board, ms_user_history_t *history, int seconds, int wins){
+    return leaderboard_add(board, history, seconds, wins, true);
+}
+
+ms_leader_t* leaderboard_first(ms_leaderboard_t *board){
+    return board->head->next[0];
+}
+
+ms_leader_t* leaderboard_next(ms_leader_t *leader){
+    return leader->next[0];
+}
+
+/***********************************************************************
+ * func:            Adds an entry to a leaderboard. Returns the new
+ *                  entry, or NULL if the system has run out of memory.
+ * param board:     The leaderboard to add to.
+ * param history:   The history of the user who achieved the time.
+ * param seconds:   The time taken to complete the game.
+ * param wins:      The games the user has won, including this one.
+ * param last:      Whether the entry is known to go last, so it can
+ *                  follow the last entry on each level without a
+ *                  search.
+***********************************************************************/
+ms_leader_t* leaderboard_add(ms_leaderboard_t *board, ms_user_history_t *history, int seconds, int wins, bool last){
+
+    ms_leader_t *update[LEADERBOARD_MAX_LEVEL];
+    ms_leader_t *pointer = board->head;
+    int i, level;
+
+    /* Find the last entry on each level that goes before the new one */
+    for (i=board->level-1;i>=0;i--){
+        if (last){
+            update[i] = board->tail[i];
+            continue;
+        }
+        while (pointer->next[i] &&
+                leaderboard_compare(seconds, wins, history->username, pointer->next[i]) >= 0){
+            pointer = pointer->next[i];
+        }
+        update[i] = pointer;
+    }
+
+    level = leaderboard_random_level(board);
+    if (level > board->level){
+        for (i=board->level;i<level;i++){
+            update[i] = board->head;
+        }
+        board->level = level;
+    }
+
+    ms_leader_t *leader = leaderboard_new_leader(level);
+    if (!leader){
+        return NULL;
+    }
+
+    leader->seconds_taken = seconds;
+    leader->wins = wins;
+    leader->history = history;
+
+    for (i=0;i<level;i++){
+        leader->next[i] = update[i]->next[i];
+        update[i]->next[i] = leader;
+
+        if (!leader->next[i]){
+            board->tail[i] = leader;
+        }
+    }
+
+    board->length++;
+
+    return leader;
+}
+
+/***********************************************************************
+ * func:            Compares a time, win count and name with those of a
+ *                  given entry. Returns less than 0 if they go before
+ *                  the entry, 0 if they are equal, and more than 0 if
+ *                  they go after it.
+ * param seconds:   The time taken.
+ * param wins:      The games won.
+ * param name:      The username.
+ * param leader:    The entry to compare with.
+***********************************************************************/
+int leaderboard_compare(int seconds, int wins, const char *name, ms_leader_t *leader){
+
+    if (seconds != leader->seconds_taken){
+        return seconds > leader->seconds_taken ? -1 : 1;
+    }
+
+    if (wins != leader->wins){
+        return wins < leader->wins ? -1 : 1;
+    }
+
+    return strcasecmp(name, leader->history->username);
+}
+
+/***********************************************************************
+ * func:            Chooses the level of a new entry, with each level
+ *                  a quarter as likely as the one below.
+ * param board:     The leaderboard the entry is for.
+***********************************************************************/
+int leaderboard_random_level(ms_leaderboard_t *board){
+
+    int level = 1;
+    uint64_t bits;
+
+    /* xorshift64 */
+    board->random ^= board->random << 13;
+    board->random ^= board->random >> 7;
+    board->random ^= board->random << 17;
+    bits = board->random;
+
+    while ((bits & 3) == 0 && level < LEADERBOARD_MAX_LEVEL){
+        level++;
+        bits >>= 2;
+    }
+
+    return level;
+}
+
+/***********************************************************************
+ * func:            Allocates an entry with a given number of levels.
+ * param level:     The number of levels.
+***********************************************************************/
+ms_leader_t* leaderboard_new_leader(int level){
+
+    ms_leader_t *leader = calloc(1, sizeof(ms_leader_t) + level*sizeof(leader->next[0]));
+
+    if (leader){
+        leader->level = level;
+    }
+
+    return leader;
+}
@@ -0,0 +1,85 @@
+#ifndef LEADERBOARD_H_
+#define LEADERBOARD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* History definitions */
+#include "history.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Most levels of the skip list, enough for 4^32 entries */
+#define LEADERBOARD_MAX_LEVEL 32
+
+/* A struct representing a single leaderboard entry. Each level links
+ * to the next entry on that level */
+typedef struct ms_leader ms_leader_t;
+struct ms_leader{
+    int seconds_taken;
+    int wins;                       /* Games won by the user at the time */
+    ms_user_history_t *history;     /* The user who achieved the time */
+    int level;
+    ms_leader_t *next[];
+};
+
+/* A struct representing a leaderboard, kept as a skip list in the order
+ * it is displayed: longest time first, then fewest wins, then by name.
+ * The best entry is therefore the last. Ranks and pages are served from
+ * the published scoreboard snapshot, so the list is only ever walked in
+ * order */
+typedef struct{
+    ms_leader_t *head;
+    ms_leader_t *tail[LEADERBOARD_MAX_LEVEL];   /* Last entry on each level */
+    int level;
+    size_t length;
+    uint64_t random;                /* State for choosing entry levels */
+} ms_leaderboard_t;
+
+/***********************************************************************
+ * func:            Initializes an empty leaderboard. Returns ERROR if
+ *                  the system has run out of memory.
+ * param board:     The leaderboard to initialize.
+***********************************************************************/
+int leaderboard_init(ms_leaderboard_t *board);
+
+/***********************************************************************
+ * func:            Adds an entry to a leaderboard in O(log n). Entries
+ *                  equal to existing ones are placed after them.
+ *                  Returns the new entry, or NULL if the system has
+ *                  run out of memory.
+ * param board:     The leaderboard to add to.
+ * param history:   The history of the user who achieved the time.
+ * param seconds:   The time taken to complete the game.
+ * param wins:      The games the user has won, including this one.
+***********************************************************************/
+ms_leader_t* leaderboard_insert(ms_leaderboard_t *board, ms_user_history_t *history, int seconds, int wins);
+
+/***********************************************************************
+ * func:            Adds an entry that goes after every entry already
+ *                  on a leaderboard, without comparing it with them.
+ *                  Used to rebuild a leaderboard from its entries in
+ *                  display order. Returns the new entry, or NULL if
+ *                  the system has run out of memory.
+ * param board:     The leaderboard to add to.
+ * param history:   The history of the user who achieved the time.
+ * param seconds:   The time taken to complete the game.
+ * param wins:      The games the user had won, including this one.
+***********************************************************************/
+ms_leader_t* leaderboard_append(ms_leaderboard_t *board, ms_user_history_t *history, int seconds, int wins);
+
+/***********************************************************************
+ * func:            Returns the first entry in display order, or NULL
+ *                  if the leaderboard is empty.
+ * param board:     The leaderboard to read.
+***********************************************************************/
+ms_leader_t* leaderboard_first(ms_leaderboard_t *board);
+
+/***********************************************************************
+ * func:            Returns the entry after a given entry in display
+ *                  order, or NULL if it is the last.
+ * param leader:    The entry to step from.
+***********************************************************************/
+ms_leader_t* leaderboard_next(ms_leader_t *leader);
+
+#endif /* LEADERBOARD_H_ */
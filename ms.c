@@ -1,44 +1,52 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 /* Minesweeper definitions */
 #include "ms.h"
 /* Utility definitions */
 #include "utils.h"
 
+static inline int tile_index(ms_game_t *game, int x, int y){
+    return y*game->config.cols + x;
+}
+
 bool location_bomb(ms_game_t *game, int x, int y){
-    return (game->board[x][y].bomb);
+    return BIT_TEST(game->bombs, tile_index(game,x,y));
 }
 
 bool location_valid(ms_game_t *game, int x, int y){
-    return (x>= 0 && y>=0 && x<MS_COLS && y<MS_ROWS);
+    return (x>= 0 && y>=0 && x<game->config.cols && y<game->config.rows);
 }
 
 bool location_revealed(ms_game_t *game, int x, int y){
-    return (game->board[x][y].revealed);
+    return BIT_TEST(game->revealed, tile_index(game,x,y));
 }
 
 bool location_flagged(ms_game_t *game, int x, int y){
-    return game->board[x][y].flagged;
+    return BIT_TEST(game->flagged, tile_index(game,x,y));
 }
 
 bool place_bomb(ms_game_t *game, int x, int y){
 
     /* If there is already a bomb at location */
-	if (game->board[x][y].bomb){
+    if (location_bomb(game,x,y)){
         return false;
     }
-    
+
     int xi, yi;
-    game->board[x][y].bomb = true;
+    BIT_SET(game->bombs, tile_index(game,x,y));
+    if (location_flagged(game,x,y)){
+        game->flags_correct++;
+    }
 
-	/* Increment the adjacent value of all adjacent tiles */
+    /* Increment the adjacent value of all adjacent tiles */
     for (yi=y-1;yi<=y+1;yi++){
-		for (xi=x-1;xi<=x+1;xi++){
+        for (xi=x-1;xi<=x+1;xi++){
             if (!(xi==x && yi==y)){
-                if (xi>=0 && xi<MS_COLS && yi>=0 && yi<MS_ROWS){
-                    game->board[xi][yi].adjacent++;
+                if (location_valid(game, xi, yi)){
+                    game->adjacent[tile_index(game,xi,yi)]++;
                 }
             }
         }
@@ -51,13 +59,14 @@ bool place_bomb(ms_game_t *game, int x, int y){
 void remove_bomb(ms_game_t *game, int x, int y){
     int xi,yi;
 
-    game->board[x][y].bomb = false;
-    for (xi=x-1;xi<=x+1;xi++){
-        for (yi=y-1;yi<=y+1;yi++){
-            if (location_valid(game, xi, yi)){
-                if (!(xi==x && yi==y)&&!location_bomb(game,xi,yi)){  /* If not the bomb itself, or any other bomb */
-                    game->board[xi][yi].adjacent--;
-                }
+    BIT_CLEAR(game->bombs, tile_index(game,x,y));
+    if (location_flagged(game,x,y)){
+        game->flags_correct--;
+    }
+    for (yi=y-1;yi<=y+1;yi++){
+        for (xi=x-1;xi<=x+1;xi++){
+            if (location_valid(game, xi, yi) && !(xi==x && yi==y)){
+                game->adjacent[tile_index(game,xi,yi)]--;
             }
         }
     }
@@ -65,56 +74,128 @@ void remove_bomb(ms_game_t *game, int x, int y){
 }
 
 int bombs_remaining(ms_game_t *game){
-    int x,y,remaining = 0;
-
-    for (y=0;y<MS_ROWS;y++){
-        for (x=0;x<MS_COLS;x++){
-            if (game->board[x][y].bomb && !game->board[x][y].flagged){
-                remaining++;
-            }
-        }
-    }
-
-    return remaining;
+    return game->config.bombs - game->flags_correct;
 }
 
 void reveal_board(ms_game_t *game){
-    int x, y;
+    int i;
 
-    for (y=0;y<MS_ROWS;y++){
-        for(x=0;x<MS_COLS;x++){
-            if (game->board[x][y].flagged){
-                game->board[x][y].flagged = false;
-            }
-            game->board[x][y].revealed = true;
-        }
+    for (i=0;i<game->words;i++){
+        game->flagged[i] = 0;
+        game->revealed[i] = ~0ULL;
+        game->frontier[i] = 0;
     }
+    game->revealed[game->words-1] = LAST_WORD_MASK(game);
+
+    game->hidden_safe = 0;
+    game->flags_correct = 0;
+    game->flags_placed = 0;
+    game->over = true;
+
+}
 
+bool game_over(ms_game_t *game){
+    return game->over;
 }
 
 bool check_win(ms_game_t *game){
-    int x,y;
 
     if (bombs_remaining(game) == 0){
         reveal_board(game);
         return true;
     }
 
-    for (y=0;y<MS_ROWS;y++){
-        for (x=0;x<MS_COLS;x++){
-            /* If there is a tile that is not revealed and isnt a bomb, they havent won yet */
-            if (!game->board[x][y].revealed && !game->board[x][y].bomb){
-                return false;
+    /* If there is a tile that is not revealed and isnt a bomb, they havent won yet */
+    if (game->hidden_safe == 0){
+        game->over = true;
+        return true;
+    }
+
+    return false;
+}
+
+/* Maps the nth tile that is not kept clear to its index, given the kept
+ * tiles in ascending order */
+int skip_clear(int n, int *clear, int clear_num){
+    int k;
+
+    for (k=0;k<clear_num;k++){
+        if (n >= clear[k]){
+            n++;
+        }
+    }
+
+    return n;
+}
+
+/* Places the bombs of a board at its first reveal, keeping the revealed
+ * tile and those around it clear, or only the tile itself if the board
+ * is too full for that */
+void place_bombs(ms_game_t *game, int x, int y){
+    int clear[9], clear_num = 0;
+    int candidates, i, j, xi, yi;
+
+    for (yi=y-1;yi<=y+1;yi++){
+        for (xi=x-1;xi<=x+1;xi++){
+            if (location_valid(game,xi,yi)){
+                clear[clear_num++] = tile_index(game,xi,yi);
             }
         }
     }
+    if (game->tiles - clear_num < game->config.bombs){
+        clear[0] = tile_index(game,x,y);
+        clear_num = 1;
+    }
+    candidates = game->tiles - clear_num;
+
+    /* Floyd's sampling, which draws once per bomb. Each step takes a
+     * random candidate up to j, or j itself if that one has a bomb, so
+     * every set of tiles is equally likely */
+    for (j=candidates-game->config.bombs;j<candidates;j++){
+        i = skip_clear(rng_below(&game->rng, j+1), clear, clear_num);
+        if (BIT_TEST(game->bombs, i)){
+            i = skip_clear(j, clear, clear_num);
+        }
+        place_bomb(game, i%game->config.cols, i/game->config.cols);
+    }
+}
+
+int tile_value(ms_game_t *game, int x, int y){
+    int i = tile_index(game,x,y);
+
+    if (BIT_TEST(game->flagged, i)){
+        return FLAG_VAL;
+    } else if (BIT_TEST(game->revealed, i)){
+        if (BIT_TEST(game->bombs, i)){
+            return BOMB_VAL;
+        }
+        return game->adjacent[i];
+    }
 
-    return true;
+    return UNSELECTED_VAL;
 }
 
 req_t flag_tile(ms_game_t *game, int x, int y){
 
-    game->board[x][y].flagged = !game->board[x][y].flagged;
+    int i = tile_index(game,x,y);
+
+    game->changed_num = 0;
+
+    /* A finished game takes no more moves */
+    if (game->over){
+        return invalid;
+    }
+
+    BIT_FLIP(game->flagged, i);
+    if (BIT_TEST(game->flagged, i)){
+        game->flags_placed++;
+        game->flags_correct += BIT_TEST(game->bombs, i);
+    } else {
+        game->flags_placed--;
+        game->flags_correct -= BIT_TEST(game->bombs, i);
+    }
+    game->changed[0] = i;
+    game->changed_num = 1;
 
     if (check_win(game)){
         reveal_board(game);
@@ -122,81 +203,231 @@ req_t flag_tile(ms_game_t *game, int x, int y){
     }
 
     return valid;
-    
+
 }
 
-req_t reveal_tile(ms_game_t *game, int x, int y){
+/* Reveals the blank areas around the tiles already in the changed list,
+ * adding them to it, and moves the frontier past every tile revealed */
+req_t reveal_changed(ms_game_t *game){
 
-	if (location_bomb(game,x,y)) {
-        if (game->first_turn){                   /* Impossible for a bomb to be hit on first go */
-            remove_bomb(game,x,y);
-            for (int j = 0;j<MS_ROWS;j++){
-                for (int i=0;i<MS_COLS;i++){
-                    if (place_bomb(game,i,j)){   /* Places the bomb at first possible x location */
-                        reveal_tile(game,x,y);
-                        game->first_turn = false;
-                        return valid;
+    int i, j, head, xi, yi, cx, cy;
+
+    /* Flood fill outwards from blank tiles, using the changed list as the queue */
+    for (head=0;head<game->changed_num;head++){
+        i = game->changed[head];
+        if (game->adjacent[i] != 0){
+            continue;
+        }
+
+        cx = i % game->config.cols;
+        cy = i / game->config.cols;
+        for (yi=cy-1;yi<=cy+1;yi++){
+            for (xi=cx-1;xi<=cx+1;xi++){
+                if (location_valid(game,xi,yi)){
+                    j = tile_index(game,xi,yi);
+                    if (!BIT_TEST(game->revealed, j) && !BIT_TEST(game->flagged, j)){
+                        BIT_SET(game->revealed, j);
+                        game->changed[game->changed_num++] = j;
+                        game->hidden_safe--;
                     }
                 }
             }
         }
-        
-        reveal_board(game);
-        return lost;
+    }
 
-    } else if (game->board[x][y].adjacent == 0){  /* If blank spot chosen, reveal all nearby blank spots */
-        for (int i = x-1; i<=x+1; i++){
-            for (int j = y-1; j<=y+1; j++){
-                    if (i>=0 && j>=0 && i<MS_COLS && j<MS_ROWS){
-                        if (!game->board[i][j].revealed){
-                            game->board[i][j].revealed = true;
-                            reveal_tile(game,i,j);
-                        }
-                    }
-                
+    /* The tiles revealed leave the frontier, and bring their hidden neighbours into it */
+    for (head=0;head<game->changed_num;head++){
+        i = game->changed[head];
+        BIT_CLEAR(game->frontier, i);
+
+        cx = i % game->config.cols;
+        cy = i / game->config.cols;
+        for (yi=cy-1;yi<=cy+1;yi++){
+            for (xi=cx-1;xi<=cx+1;xi++){
+                if (location_valid(game,xi,yi) && !location_revealed(game,xi,yi)){
+                    BIT_SET(game->frontier, tile_index(game,xi,yi));
+                }
             }
         }
-    } else {
-        game->board[x][y].revealed = true;
     }
 
+    if (check_win(game)){
+        return won;
+    }
+
+    return valid;
+
+}
+
+req_t reveal_tile(ms_game_t *game, int x, int y){
+
+    int i;
+
+    game->changed_num = 0;
+
+    /* A finished game takes no more moves */
+    if (game->over){
+        return invalid;
+    }
+
+    /* Bombs are only placed once the first tile is revealed, so it is
+     * never one of them */
     if (game->first_turn){
+        place_bombs(game,x,y);
         game->first_turn = false;
     }
 
-    if (check_win(game)){
-        return won;
+    if (location_bomb(game,x,y)) {
+        reveal_board(game);
+        return lost;
     }
 
-    return valid;
-    
-}
-
-ms_game_t new_game(int rand_seed){
-    ms_game_t game;
-    srand(rand_seed);
-
-    int i,x,y;
-
-    game.first_turn = true;
-
-    /* Initialize array */
-	for (y=0;y<MS_ROWS;y++){
-		for (x=0;x<MS_COLS;x++){
-			game.board[x][y].adjacent = 0;
-			game.board[x][y].bomb = false;
-			game.board[x][y].flagged = false;
-			game.board[x][y].revealed = false;
-		}
-	}
-
-    /* Place bombs */
-	for (i=0;i<MS_BOMBS;i++){
-		do{
-			x = rand() % MS_COLS;
-			y = rand() % MS_ROWS;
-		} while (!place_bomb(&game,x,y));
-	}
-    
+    i = tile_index(game,x,y);
+    BIT_SET(game->revealed, i);
+    game->changed[game->changed_num++] = i;
+    game->hidden_safe--;
+
+    return reveal_changed(game);
+
+}
+
+req_t chord_tile(ms_game_t *game, int x, int y){
+
+    int xi, yi, i;
+
+    game->changed_num = 0;
+
+    /* A finished game takes no more moves */
+    if (game->over){
+        return invalid;
+    }
+
+    /* Nothing is revealed unless every neighbour is safe */
+    for (yi=y-1;yi<=y+1;yi++){
+        for (xi=x-1;xi<=x+1;xi++){
+            if (location_valid(game,xi,yi) && !location_revealed(game,xi,yi) &&
+                    !location_flagged(game,xi,yi) && location_bomb(game,xi,yi)){
+                reveal_board(game);
+                return lost;
+            }
+        }
+    }
+
+    for (yi=y-1;yi<=y+1;yi++){
+        for (xi=x-1;xi<=x+1;xi++){
+            if (location_valid(game,xi,yi) && !location_revealed(game,xi,yi) && !location_flagged(game,xi,yi)){
+                i = tile_index(game,xi,yi);
+                BIT_SET(game->revealed, i);
+                game->changed[game->changed_num++] = i;
+                game->hidden_safe--;
+            }
+        }
+    }
+
+    return reveal_changed(game);
+
+}
+
+int flags_around(ms_game_t *game, int x, int y){
+
+    int flags = 0, xi, yi;
+
+    for (yi=y-1;yi<=y+1;yi++){
+        for (xi=x-1;xi<=x+1;xi++){
+            if (location_valid(game,xi,yi) && location_flagged(game,xi,yi)){
+                flags++;
+            }
+        }
+    }
+
+    return flags;
+}
+
+void mark_dirty(ms_game_t *game){
+
+    int i;
+
+    for (i=0;i<game->changed_num;i++){
+        BIT_SET(game->dirty, game->changed[i]);
+    }
+}
+
+void gather_dirty(ms_game_t *game){
+
+    uint64_t bits;
+    int w;
+
+    game->changed_num = 0;
+    for (w=0;w<game->words;w++){
+        for (bits=game->dirty[w];bits;bits&=bits-1){
+            game->changed[game->changed_num++] = w*64 + __builtin_ctzll(bits);
+        }
+        game->dirty[w] = 0;
+    }
+}
+
+bool config_valid(ms_config_t config){
+    if (!(config.cols > 0 && config.cols <= MS_MAX_COLS &&
+            config.rows > 0 && config.rows <= MS_MAX_ROWS &&
+            config.bombs > 0 && config.bombs < config.cols*config.rows)){
+        return false;
+    }
+
+    /* No-guess boards need room to open up around the first reveal */
+    return !config.no_guess || (config.bombs <= config.cols*config.rows - 9 &&
+            (long)config.bombs*100 <= (long)config.cols*config.rows*MS_NO_GUESS_MAX_DENSITY);
+}
+
+/* Size of the memory following a game struct, which holds five bit
+ * planes, the changed list and the adjacency counts */
+static inline size_t storage_size(int tiles, int words){
+    return 5*words*sizeof(uint64_t) + tiles*sizeof(int) + tiles;
+}
+
+ms_game_t* new_game(uint64_t seed, ms_config_t config){
+    int tiles = config.cols*config.rows;
+    int words = (tiles+63)/64;
+
+    /* One allocation holds the struct and its storage */
+    ms_game_t *game = calloc(1, sizeof(ms_game_t) + storage_size(tiles, words));
+    if (!game){
+        return NULL;
+    }
+
+    rng_seed(&game->rng, seed);
+
+    game->config = config;
+    game->seed = seed;
+    game->tiles = tiles;
+    game->words = words;
+    game->first_turn = true;
+    game->hidden_safe = tiles - config.bombs;
+    game->bombs = game->storage;
+    game->flagged = game->bombs + words;
+    game->revealed = game->flagged + words;
+    game->frontier = game->revealed + words;
+    game->dirty = game->frontier + words;
+    game->changed = (int*)(game->dirty + words);
+    game->adjacent = (uint8_t*)(game->changed + tiles);
+
     return game;
-}
\ No newline at end of file
+}
+
+void reset_game(ms_game_t *game, uint64_t seed){
+    memset(game->storage, 0, storage_size(game->tiles, game->words));
+
+    rng_seed(&game->rng, seed);
+
+    game->seed = seed;
+    game->first_turn = true;
+    game->over = false;
+    game->hidden_safe = game->tiles - game->config.bombs;
+    game->flags_correct = 0;
+    game->flags_placed = 0;
+    game->changed_num = 0;
+    game->next = NULL;
+}
+
+void free_game(ms_game_t *game){
+    free(game);
+}
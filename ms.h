@@ -2,52 +2,132 @@
 #define MS_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
+/* Random number definitions */
+#include "rng.h"
 /* Utility definitions */
 #include "utils.h"
 
-#define MS_COLS 9       /* Size of x axis of a game board. Undef behaviour if > 99 */
-#define MS_ROWS 9       /* Size of y axis of a game board. Undef behaviour if > 99 */
-#define MS_BOMBS 10     /* Number of bombs to be in a single game. Undef behaviour if > MS_COLS*MS_ROWS */
+/* Bit plane helpers, where i is the row-major index of a tile */
+#define BIT_WORD(i) ((i) >> 6)
+#define BIT_MASK(i) (1ULL << ((i) & 63))
+#define BIT_TEST(plane, i) (((plane)[BIT_WORD(i)] & BIT_MASK(i)) != 0)
+#define BIT_SET(plane, i) ((plane)[BIT_WORD(i)] |= BIT_MASK(i))
+#define BIT_CLEAR(plane, i) ((plane)[BIT_WORD(i)] &= ~BIT_MASK(i))
+#define BIT_FLIP(plane, i) ((plane)[BIT_WORD(i)] ^= BIT_MASK(i))
 
-/* A struct representing a single square on the game board */
-typedef struct {
-    bool bomb;
-    bool flagged;
-    bool revealed;
-    int adjacent;
-} ms_tile_t;
+/* Mask of the bits in the last word of a plane that represent tiles */
+#define LAST_WORD_MASK(game) (((game)->tiles & 63) ? (1ULL << ((game)->tiles & 63)) - 1 : ~0ULL)
 
-/* A struct representing a group of tiles, indicative of a game board */
+/* A struct representing a game board. Each tile is addressed by its
+ * row-major index (y*cols + x), with one bit per tile in each plane.
+ * The planes and adjacency counts are allocated along with the struct */
 typedef struct {
-    ms_tile_t board[MS_COLS][MS_ROWS];
-    bool first_turn;
+    ms_config_t config;             /* Dimensions and bomb count of the board */
+    uint64_t seed;                  /* Seed the bombs were placed from */
+    ms_rng_t rng;                   /* Generator the bombs are placed with */
+    int tiles;                      /* Total tiles on the board */
+    int words;                      /* 64 bit words in each bit plane */
+    bool first_turn;                /* Whether the bombs are yet to be placed */
+    bool over;                      /* Whether the game has been won or lost */
+    int hidden_safe;                /* Tiles without a bomb that are yet to be revealed */
+    int flags_correct;              /* Flags placed on tiles containing a bomb */
+    int flags_placed;               /* Flags placed in total */
+    uint64_t *bombs;                /* Tiles containing a bomb */
+    uint64_t *flagged;              /* Tiles flagged by the player */
+    uint64_t *revealed;             /* Tiles revealed to the player */
+    uint64_t *frontier;             /* Hidden tiles next to a revealed tile */
+    uint64_t *dirty;                /* Tiles altered by a run of moves so far */
+    uint8_t *adjacent;              /* Number of bombs adjacent to each tile */
+    int *changed;                   /* Indices of the tiles altered by the last move */
+    int changed_num;                /* Number of tiles in changed */
+    void *next;                     /* Next board while it waits in a pool */
+    uint64_t storage[];
 } ms_game_t;
 
 /***********************************************************************
- * func:            Creates a new game state based on a given seed.
- * param rand_seed: The specified seed value.
+ * func:            Creates a new game state based on a given seed and
+ *                  board configuration. Bombs are placed at the first
+ *                  reveal, away from the revealed tile, so the same
+ *                  seed, configuration and first reveal always give the
+ *                  same board. Returns NULL if the game could not be
+ *                  allocated.
+ * param seed:      The specified seed value.
+ * param config:    The dimensions and bomb count of the board.
+***********************************************************************/
+ms_game_t* new_game(uint64_t seed, ms_config_t config);
+
+/***********************************************************************
+ * func:            Returns a game state created by new_game to how
+ *                  new_game left it, with a new seed, so that its
+ *                  memory can be used for another game of the same
+ *                  dimensions and bomb count.
+ * param game:      The game state to reset.
+ * param seed:      The new seed value.
+***********************************************************************/
+void reset_game(ms_game_t *game, uint64_t seed);
+
+/***********************************************************************
+ * func:            Frees a game state created by new_game.
+ * param game:      The game state to free.
+***********************************************************************/
+void free_game(ms_game_t *game);
+
+/***********************************************************************
+ * func:            Determines if a given board configuration can be
+ *                  played, IE: within MS_MAX_COLS and MS_MAX_ROWS, with
+ *                  at least one bomb and one free tile. No-guess boards
+ *                  also need nine free tiles, and at most
+ *                  MS_NO_GUESS_MAX_DENSITY percent of bombs.
+ * param config:    The configuration to check.
 ***********************************************************************/
-ms_game_t new_game(int rand_seed);
+bool config_valid(ms_config_t config);
 
 /***********************************************************************
  * func:            Flags a tile at a given location on a given game
- *                  board.
+ *                  board. The flagged tile is recorded in changed.
+ *                  Returns invalid once the game is over.
  * param game:      The game board to alter.
  * param x:         The x location of the flag.
  * param y:         The y location of the flag.
 ***********************************************************************/
 req_t flag_tile(ms_game_t *game, int x, int y);
 
+/***********************************************************************
+ * func:            Determines if a given game board has been won or
+ *                  lost, after which no further moves can be made.
+ * param game:      The game board to check.
+***********************************************************************/
+bool game_over(ms_game_t *game);
+
 /***********************************************************************
  * func:            Reveals a tile at a given location on a given game
- *                  board.
+ *                  board. If the tile has no adjacent bombs, the blank
+ *                  area around it is revealed too. Every tile revealed
+ *                  is recorded in changed. The first reveal places the
+ *                  bombs, keeping the tile and its neighbours clear
+ *                  where the board has room. Returns invalid once the
+ *                  game is over.
  * param game:      The game board to alter.
  * param x:         The x location of the flag.
  * param y:         The y location of the flag.
 ***********************************************************************/
 req_t reveal_tile(ms_game_t *game, int x, int y);
 
+/***********************************************************************
+ * func:            Reveals every hidden tile around a revealed number
+ *                  that is not flagged, as a single move. If any of
+ *                  them holds a bomb the game is lost and none are
+ *                  revealed, otherwise each is revealed as by
+ *                  reveal_tile, and all of them are recorded in
+ *                  changed. Returns invalid once the game is over.
+ * param game:      The game board to alter.
+ * param x:         The x location of the number.
+ * param y:         The y location of the number.
+***********************************************************************/
+req_t chord_tile(ms_game_t *game, int x, int y);
+
 /***********************************************************************
  * func:            Determines if a given location on a given game
  *                  board has been flagged.
@@ -75,6 +155,25 @@ bool location_revealed(ms_game_t *game, int x, int y);
 ***********************************************************************/
 bool location_valid(ms_game_t *game, int x, int y);
 
+/***********************************************************************
+ * func:            Returns the value of a tile as it is to be shown to
+ *                  the player, IE: FLAG_VAL, UNSELECTED_VAL, BOMB_VAL
+ *                  or the number of adjacent bombs.
+ * param game:      The game board to check.
+ * param x:         The x location to check.
+ * param y:         The y location to check.
+***********************************************************************/
+int tile_value(ms_game_t *game, int x, int y);
+
+/***********************************************************************
+ * func:            Returns the number of flags around a given location
+ *                  on a given game board.
+ * param game:      The game board to check.
+ * param x:         The x location to check.
+ * param y:         The y location to check.
+***********************************************************************/
+int flags_around(ms_game_t *game, int x, int y);
+
 /***********************************************************************
  * func:            Returns the total number of bombs remaining on a
  *                  given game board. A bomb is considered to be
@@ -82,4 +181,21 @@ bool location_valid(ms_game_t *game, int x, int y);
 ***********************************************************************/
 int bombs_remaining(ms_game_t *game);
 
+/***********************************************************************
+ * func:            Marks the tiles altered by the last move as dirty,
+ *                  so that those altered by a run of moves can be
+ *                  gathered once it ends.
+ * param game:      The game board the move was made on.
+***********************************************************************/
+void mark_dirty(ms_game_t *game);
+
+/***********************************************************************
+ * func:            Replaces the changed list of a game board with its
+ *                  dirty tiles, each listed once in order of index, and
+ *                  clears them. The cost grows with the size of the
+ *                  board only by a pass over the words of a plane.
+ * param game:      The game board to gather the dirty tiles of.
+***********************************************************************/
+void gather_dirty(ms_game_t *game);
+
 #endif /* MS_H_ */
\ No newline at end of file
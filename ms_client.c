@@ -19,22 +19,44 @@ int socket_fd = 0;
 /* The width of the screen line seperators printed to the screen */
 int line_width = 64;
 
+/* Number of scoreboard entries shown at a time */
+#define SCOREBOARD_PAGE_SIZE 10
+
 /* The current user */
 ms_user_t session_user;
 
+/* Data recieved from the server that has not yet been read */
+char recv_data[4096];
+size_t recv_start = 0;
+size_t recv_end = 0;
+
+/* The clients copy of the current game board, kept up to date with
+ * the changes sent by the server after each move */
+int board_cols = 0;
+int board_rows = 0;
+int board_bombs = 0;
+int *board_values = NULL;
+
 /* Function definitions */
 coord_req_t get_coords();
 
 req_t send_request(coord_req_t request);
 
+ms_scoreboard_page_t recieve_scoreboard(ms_scoreboard_query_t query);
+
 int get_menu_choice();
+int recv_buffered(void *data, size_t len);
+
+bool choose_difficulty();
 
 void connect_to_server(char* argv[]);
 void exit_gracefully();
 void ms_process();
 void print_menu(menu_t menu_type);
+void recieve_changes();
 void recieve_game();
-void recieve_scoreboard();
+void show_game();
+void show_scoreboard();
 void verify_user();
 void welcome_screen();
 
@@ -71,7 +93,7 @@ int main(int argc, char* argv[]){
                 break;
             /* Show Leaderboard */
             case 2:
-                recieve_scoreboard();
+                show_scoreboard();
                 break;
             /* Quit */
             case 3:
@@ -115,6 +137,8 @@ void connect_to_server(char* argv[]){
         exit(EXIT_FAILURE);
     }
 
+    set_low_latency(socket_fd);
+
 }
 
 /***********************************************************************
@@ -131,11 +155,18 @@ void ms_process(){
     coord_req_t request;
     req_t response = valid;
 
+    if (!choose_difficulty()){
+        printf("\nInvalid board configuration...\n");
+        return;
+    }
+
+    recieve_game();
+
     while (ingame){
 
         if (response == valid){
             clear_screen();
-            recieve_game();
+            show_game();
         } else {
             printf("\nInvalid choice...\n");
         }
@@ -151,14 +182,18 @@ void ms_process(){
                 case 2:
                     printf("\n   --> Currently in flag mode");
                     break;
+                case 3:
+                    printf("\n   --> Currently in chord mode");
+                    break;
             }
             printf("\n 0 --> Change mode\n");
         }
 
         switch (game_menu_choice){
 
-            /* Place tile */
+            /* Place tile, or the tiles around a number */
             case 1:
+            case 3:
                 request = get_coords();
                 if (request.x < 0){
                     request.y = -1;
@@ -166,10 +201,13 @@ void ms_process(){
                     response = valid;
                     break;
                 }
-                request.request_type = reveal;
+                request.request_type = game_menu_choice == 1 ? reveal : chord;
                 response = send_request(request);
-                if (response == lost){
+                if (response == valid){
+                    recieve_changes();
+                } else if (response == lost){
                     recieve_game();
+                    show_game();
                     printf("\nYou've hit a bomb! Game over!\n");
                     request.request_type = lost;
                     send_request(request);
@@ -190,13 +228,15 @@ void ms_process(){
                 }
                 request.request_type = flag;
                 response = send_request(request);
-                if (response == won){
+                if (response == valid){
+                    recieve_changes();
+                } else if (response == won){
                     printf("\nCongratulations %s, you have won!\nYour score has been added to the scoreboard.\n", session_user.username);
                     return;
                 }
                 break;
             /* Exit */
-            case 3:
+            case 4:
                 ingame = false;
                 coord_req_t quit;
                 quit.request_type = lost;
@@ -212,6 +252,63 @@ void ms_process(){
 
 }
 
+/***********************************************************************
+ * func:            A function used to query the user for the board
+ *                  they wish to play and configure the server game
+ *                  accordingly. Returns false if the server rejected
+ *                  the configuration.
+***********************************************************************/
+bool choose_difficulty(){
+
+    ms_config_t config;
+    int cols, rows, density;
+
+    print_menu(difficulty_menu);
+
+    switch (get_menu_choice()){
+        case 2:
+            config = MS_INTERMEDIATE;
+            break;
+        case 3:
+            config = MS_EXPERT;
+            break;
+        case 4:
+            printf("Width (1-%d) --> ", MS_MAX_COLS);
+            scanf("%d", &cols);
+            printf("Height (1-%d) --> ", MS_MAX_ROWS);
+            scanf("%d", &rows);
+            printf("Mine density (%%) --> ");
+            scanf("%d", &density);
+            config = config_from_density(cols, rows, density);
+            break;
+        default:
+            config = MS_BEGINNER;
+            break;
+    }
+
+    print_menu(board_type_menu);
+    config.no_guess = get_menu_choice() == 2;
+
+    /* Send the request and the configuration together */
+    struct {
+        coord_req_t request;
+        ms_config_t config;
+    } message;
+    message.request.request_type = configure;
+    message.config = config;
+
+    if (send(socket_fd, &message, sizeof(message), PF_UNSPEC) == ERROR){
+        perror("Sending board configuration");
+    }
+
+    req_t response;
+    if (recv_buffered(&response, sizeof(req_t)) == ERROR){
+        perror("Receiving configure response");
+    }
+
+    return response == valid;
+}
+
 /***********************************************************************
  * func:            A function used to handle user input at the games
  *                  various menus.
@@ -262,22 +359,40 @@ void print_menu(menu_t menu_type){
             printf("Select a keyboard mode:\n");
             printf(" 1 --> Reveal a tile\n");
             printf(" 2 --> Place a flag\n");
-            printf(" 3 --> Quit\n");
+            printf(" 3 --> Reveal around a number\n");
+            printf(" 4 --> Quit\n");
+            break;
+        case difficulty_menu:
+            printf("Choose a difficulty:\n");
+            printf(" 1 --> Beginner (9x9, 10 mines)\n");
+            printf(" 2 --> Intermediate (16x16, 40 mines)\n");
+            printf(" 3 --> Expert (30x16, 99 mines)\n");
+            printf(" 4 --> Custom\n");
+            break;
+        case board_type_menu:
+            printf("Choose a board type:\n");
+            printf(" 1 --> Classic\n");
+            printf(" 2 --> No guessing (at most %d%% mines)\n", MS_NO_GUESS_MAX_DENSITY);
+            break;
+        case scoreboard_menu:
+            printf("Choose an option to proceed:\n");
+            printf(" 1 --> Next page\n");
+            printf(" 2 --> Previous page\n");
+            printf(" 3 --> Around my best time\n");
+            printf(" 4 --> Back\n");
             break;
     }
 
 }
 
 /***********************************************************************
- * func:            A function used to recieve the gameboard from the
- *                  server.
+ * func:            A function used to recieve the full gameboard from
+ *                  the server, replacing the clients copy of it.
 ***********************************************************************/
 void recieve_game(){
     int x,y;
     int cols, rows;
 
-    uint16_t value;
-
     coord_req_t request;
     request.request_type = gameboard;
 
@@ -285,84 +400,208 @@ void recieve_game(){
         perror("Sending game query");
     }
 
-    if (recv(socket_fd, &cols, sizeof(int), PF_UNSPEC) == ERROR){
+    if (recv_buffered(&cols, sizeof(int)) == ERROR){
         perror("Receiving data packet size");
     }
 
-    if (recv(socket_fd, &rows, sizeof(int), PF_UNSPEC) == ERROR){
+    if (recv_buffered(&rows, sizeof(int)) == ERROR){
         perror("Receiving data packet size");
     }
 
-    int values[cols][rows];
+    if (cols < 1 || rows < 1 || cols > MS_MAX_COLS || rows > MS_MAX_ROWS){
+        printf("Recieved an invalid game board\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (cols != board_cols || rows != board_rows){
+        free(board_values);
+        board_values = malloc(cols*rows*sizeof(int));
+        if (!board_values){
+            perror("Allocating game board");
+            exit(EXIT_FAILURE);
+        }
+        board_cols = cols;
+        board_rows = rows;
+    }
+
+    /* Tiles are sent row by row, followed by the bombs remaining */
+    uint16_t *values = malloc(cols*rows*sizeof(uint16_t));
+    uint32_t bombs;
+    if (!values){
+        perror("Allocating game board");
+        exit(EXIT_FAILURE);
+    }
+
+    if (recv_buffered(values, cols*rows*sizeof(uint16_t)) == ERROR){
+        perror("Receiving array");
+    }
+    if (recv_buffered(&bombs, sizeof(uint32_t)) == ERROR){
+        perror("Receiving bombs left");
+    }
 
     for (y=0;y<rows;y++){
         for (x=0;x<cols;x++){
-            if (recv(socket_fd,&value,sizeof(uint16_t), PF_UNSPEC) == ERROR){
-                perror("Receiving array");
-            }
-            values[x][y] = ntohs(value);
+            board_values[x*rows + y] = ntohs(values[y*cols + x]);
         }
     }
 
-    
-    if (recv(socket_fd, &value, sizeof(uint16_t), PF_UNSPEC) == ERROR){
+    board_bombs = ntohl(bombs);
+    free(values);
+}
+
+/***********************************************************************
+ * func:            A function used to recieve the tiles changed by a
+ *                  valid move from the server, and apply them to the
+ *                  clients copy of the gameboard.
+***********************************************************************/
+void recieve_changes(){
+    int i, count, x, y;
+    uint32_t bombs;
+    ms_tile_update_t update;
+
+    if (recv_buffered(&count, sizeof(int)) == ERROR){
+        perror("Receiving changed tile count");
+    }
+
+    for (i=0;i<count;i++){
+        if (recv_buffered(&update, sizeof(ms_tile_update_t)) == ERROR){
+            perror("Receiving changed tile");
+        }
+        x = ntohs(update.x);
+        y = ntohs(update.y);
+        if (x < board_cols && y < board_rows){
+            board_values[x*board_rows + y] = ntohs(update.value);
+        }
+    }
+
+    if (recv_buffered(&bombs, sizeof(uint32_t)) == ERROR){
         perror("Receiving bombs left");
     }
 
-    printf("\nBombs remaining: %d\n", ntohs(value));
-    
-    print_game(cols, rows, values);
+    board_bombs = ntohl(bombs);
 }
 
 /***********************************************************************
- * func:            A function used to recieve the scoreboard from the
- *                  server.
+ * func:            A function used to print the clients copy of the
+ *                  gameboard to the screen.
 ***********************************************************************/
-void recieve_scoreboard(){
+void show_game(){
+    printf("\nBombs remaining: %d\n", board_bombs);
 
-    int i, scoreboard_size;
-    coord_req_t request;
-    ms_user_history_entry_t historyentry;
+    print_game(board_cols, board_rows, (int (*)[board_rows])board_values);
+}
+
+/***********************************************************************
+ * func:            A function used to browse the scoreboard a page at
+ *                  a time, starting from the best times. Each page is
+ *                  fetched from the server as it is shown.
+***********************************************************************/
+void show_scoreboard(){
 
-    request.request_type = scoreboard;
+    ms_scoreboard_query_t query;
+    ms_scoreboard_page_t page;
+    int first = 0;
 
-    scoreboard_entry_t *entry = malloc(sizeof(scoreboard_entry_t));
+    query.type = top_query;
+    query.offset = 0;
+    query.limit = SCOREBOARD_PAGE_SIZE;
 
-    if (send(socket_fd, &request, sizeof(coord_req_t), PF_UNSPEC) == ERROR){
+    while (true){
+        page = recieve_scoreboard(query);
+        if (page.count > 0){
+            first = page.first_rank - 1;
+        }
+
+        if (page.total == 0){
+            return;
+        }
+
+        print_menu(scoreboard_menu);
+
+        switch (get_menu_choice()){
+            /* Worse times */
+            case 1:
+                query.type = range_query;
+                query.offset = first + SCOREBOARD_PAGE_SIZE < page.total ? first + SCOREBOARD_PAGE_SIZE : first;
+                break;
+            /* Better times */
+            case 2:
+                query.type = range_query;
+                query.offset = first > SCOREBOARD_PAGE_SIZE ? first - SCOREBOARD_PAGE_SIZE : 0;
+                break;
+            case 3:
+                query.type = around_query;
+                break;
+            case 4:
+                return;
+            default:
+                printf("Invalid choice...\n");
+                query.type = range_query;
+                query.offset = first;
+                break;
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            A function used to recieve a page of the scoreboard
+ *                  from the server and print it. Returns the header of
+ *                  the page.
+ * param query:     The page to ask for.
+***********************************************************************/
+ms_scoreboard_page_t recieve_scoreboard(ms_scoreboard_query_t query){
+
+    int i;
+    ms_scoreboard_page_t page;
+    ms_score_t entry;
+
+    /* Send the request and the query together */
+    struct {
+        coord_req_t request;
+        ms_scoreboard_query_t query;
+    } message;
+    message.request.request_type = scoreboard;
+    message.query = query;
+
+    if (send(socket_fd, &message, sizeof(message), PF_UNSPEC) == ERROR){
         perror("Sending scoreboard query");
     }
-    
-    if (recv(socket_fd, &scoreboard_size, sizeof(int), PF_UNSPEC) == ERROR){
-        perror("Recieving scoreboard size");
+
+    if (recv_buffered(&page, sizeof(ms_scoreboard_page_t)) == ERROR){
+        perror("Recieving scoreboard page");
     }
 
     printf("\n");
     print_line(line_width);
     printf("\n");
 
-    if (scoreboard_size == 0){
+    if (page.total == 0){
         printf("Scoreboard is currently empty!\n\n");
         print_line(line_width);
         fflush(stdout);
-        return;
+        return page;
     }
 
-    for (i=0;i<scoreboard_size;i++){
-        
-        if (recv(socket_fd, entry, sizeof(scoreboard_entry_t), PF_UNSPEC) == ERROR){
-            perror("Receiving scoreboard entry");
-        }
-        if (recv(socket_fd, &historyentry, sizeof(ms_user_history_entry_t), PF_UNSPEC) == ERROR){
+    for (i=0;i<page.count;i++){
+
+        if (recv_buffered(&entry, sizeof(ms_score_t)) == ERROR){
             perror("Receiving scoreboard entry");
         }
+        entry.username[MAX_USERNAME_LEN-1] = '\0';
+
+        printf("%d. Time of %d seconds by %s.\t%s has won %d of %d games\n", entry.rank, entry.seconds_taken, entry.username, entry.username, entry.won, entry.played);
+    }
 
-        printf("Time of %d seconds by %s.\t%s has won %d of %d games\n", entry->seconds_taken, entry->user.username, entry->user.username, historyentry.user.won, historyentry.user.won+historyentry.user.lost);
-        fflush(0);
+    if (page.count > 0){
+        printf("\nShowing ranks %d-%d of %d\n", page.first_rank, page.first_rank + page.count - 1, page.total);
     }
 
     printf("\n");
     print_line(line_width);
+    fflush(stdout);
 
+    return page;
 }
 
 /***********************************************************************
@@ -376,7 +615,11 @@ void exit_gracefully(){
     if (socket_fd != 0){
         coord_req_t req;
         req.request_type = quit;
-        send_request(req);
+
+        /* The server closes the connection rather than responding */
+        if (send(socket_fd, &req, sizeof(coord_req_t), MSG_NOSIGNAL) == ERROR){
+            perror("Sending quit request");
+        }
         shutdown(socket_fd,SHUT_RDWR);
         close(socket_fd);
     }
@@ -396,13 +639,64 @@ req_t send_request(coord_req_t request){
     }
 
     req_t response;
-    if (recv(socket_fd, &response, sizeof(req_t), PF_UNSPEC) == ERROR){
+    if (recv_buffered(&response, sizeof(req_t)) == ERROR){
         perror("Receiving response");
     }
 
     return response;
 }
 
+/***********************************************************************
+ * func:            A function used to read a given number of bytes
+ *                  sent by the server. Data is recieved in as large a
+ *                  block as is available, so a whole reply is usually
+ *                  read with one system call. Returns ERROR if the
+ *                  connection failed.
+ * param data:      The location to read into.
+ * param len:       The number of bytes to read.
+***********************************************************************/
+int recv_buffered(void *data, size_t len){
+
+    char *dest = data;
+    size_t available, copied = 0;
+    ssize_t result;
+
+    while (copied < len){
+        available = recv_end - recv_start;
+
+        if (available > 0){
+            if (available > len - copied){
+                available = len - copied;
+            }
+            memcpy(dest + copied, recv_data + recv_start, available);
+            recv_start += available;
+            copied += available;
+            continue;
+        }
+
+        recv_start = 0;
+        recv_end = 0;
+
+        /* Large reads go straight to their destination */
+        if (len - copied >= sizeof(recv_data)){
+            result = recv(socket_fd, dest + copied, len - copied, MSG_WAITALL);
+            if (result <= 0){
+                return ERROR;
+            }
+            copied += result;
+            continue;
+        }
+
+        result = recv(socket_fd, recv_data, sizeof(recv_data), PF_UNSPEC);
+        if (result <= 0){
+            return ERROR;
+        }
+        recv_end = result;
+    }
+
+    return len;
+}
+
 /***********************************************************************
  * func:            A function used to verify the user.
 ***********************************************************************/
@@ -414,7 +708,7 @@ void verify_user(){
     }
 
     req_t response;
-    if (recv(socket_fd, &response, sizeof(req_t), PF_UNSPEC) == ERROR){
+    if (recv_buffered(&response, sizeof(req_t)) == ERROR){
         perror("Receiving login response");
     }
 
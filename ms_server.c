@@ -7,92 +7,223 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
 
+/* Credential store definitions */
+#include "auth.h"
+/* Board pool definitions */
+#include "boards.h"
+/* Epoch definitions */
+#include "epoch.h"
+/* Generator definitions */
+#include "generator.h"
+/* History definitions */
+#include "history.h"
+/* Journal definitions */
+#include "journal.h"
+/* Leaderboard definitions */
+#include "leaderboard.h"
 /* Minesweeper definitions */
 #include "ms.h"
+/* Compute pool definitions */
+#include "pool.h"
+/* Reactor definitions */
+#include "reactor.h"
+/* Random number definitions */
+#include "rng.h"
+/* Solver definitions */
+#include "solver.h"
 /* Utility definitions */
 #include "utils.h"
 
-/* Struct of a single connection request */
-typedef struct conn_req conn_req_t;
-struct conn_req{
-    int socket_fd;
+/* Seconds a new connection has to send its credentials */
+#define LOGIN_TIMEOUT 10
+
+/* Struct of the state of a single players session */
+typedef struct ms_session ms_session_t;
+struct ms_session{
     ms_user_t user;
-    conn_req_t* next;
+    struct in_addr addr;
+    bool logged_in;
+    ms_config_t config;
+    ms_game_t *game;
+    time_t start;
+    bool timer_started;
 };
 
+/* Struct of a compute job made for a session. Only the fields used by
+ * its run and done functions are set */
+typedef struct{
+    ms_job_t job;
+    ms_user_t user;
+    ms_config_t config;
+    req_t outcome;              /* How the previous game ended, or the login */
+    int score;                  /* Seconds taken, if the game was won */
+    ms_game_t *game;            /* The newly generated game */
+    coord_req_t request;        /* The first reveal of a no-guess game */
+    uint64_t seed;              /* Seed of the no-guess board found for it */
+} ms_session_job_t;
+
+/* Buckets of the logged in users hash set, and the number of locks
+ * they are striped across. Both are powers of two */
+#define USER_BUCKETS 16384
+#define USER_STRIPES 256
+
 /* Struct of a user currently logged in */
 typedef struct ms_user_current ms_user_current_t;
 struct ms_user_current{
     ms_user_t user;
+    uint64_t hash;
     ms_user_current_t* next;
 };
 
-/* Pointer for currently logged in users linked lsit */
-ms_user_current_t* current_users = NULL;
-
-/* Pointers for connection requests linked list */
-int conn_reqs_num = 0;
-conn_req_t* conn_reqs = NULL;
-conn_req_t* conn_reqs_last = NULL;
-
-/* Pointer for user histories linked list */
-ms_user_history_entry_t* user_histories = NULL;
+/* Struct of a lock guarding every USER_STRIPES'th bucket, with counts
+ * of how often it was taken and how often that meant waiting. Each
+ * sits on its own cache line so stripes do not contend falsely */
+typedef struct{
+    pthread_mutex_t mutex;
+    unsigned long locks;
+    unsigned long contended;
+} __attribute__((aligned(64))) ms_user_stripe_t;
+
+/* Hash set of currently logged in users, keyed by username */
+ms_user_current_t* current_users[USER_BUCKETS];
+ms_user_stripe_t current_users_stripes[USER_STRIPES] = {
+    [0 ... USER_STRIPES-1] = {PTHREAD_MUTEX_INITIALIZER, 0, 0}
+};
 
-/* Pointer for scoreboard entry linked list */
-int scoreboard_entry_num = 0;
-scoreboard_entry_t *scoreboard_entries = NULL;
-scoreboard_entry_t *scoreboard_entries_last = NULL;
+/* Histories of every user who has finished a game */
+ms_history_table_t user_histories;
+
+/* Leaderboard of every game won */
+ms_leaderboard_t leaderboard;
+
+/* Struct of the start of a saved scoreboard, which is followed by
+ * every user history, then every leaderboard entry in display order */
+typedef struct{
+    uint64_t users;
+    uint64_t leaders;
+} ms_saved_scoreboard_t;
+
+/* Struct of a user history in a saved scoreboard */
+typedef struct{
+    int32_t won;
+    int32_t lost;
+    char username[MAX_USERNAME_LEN];
+} ms_saved_user_t;
+
+/* Struct of a leaderboard entry in a saved scoreboard */
+typedef struct{
+    int32_t seconds_taken;
+    int32_t wins;
+    uint32_t user;              /* Position of the user history */
+} ms_saved_leader_t;
+
+/* Struct of a slot in the index of ranked users in a snapshot */
+typedef struct{
+    uint64_t hash;
+    int index;                  /* Entry of the best time, -1 if empty */
+} ms_scoreboard_slot_t;
+
+/* Struct of an immutable copy of the scoreboard, with its entries
+ * already serialized in display order, and an index of the entry
+ * holding the best time of each user. The slots follow the entries */
+typedef struct{
+    int total;
+    size_t mask;                /* Number of slots minus one */
+    ms_scoreboard_slot_t *slots;
+    ms_score_t entries[];
+} ms_scoreboard_snapshot_t;
+
+/* The published snapshot, NULL while the scoreboard is empty. Replaced
+ * by the publisher thread, and read without locks */
+ms_scoreboard_snapshot_t* scoreboard_snapshot = NULL;
+
+/* Number of changes made to the scoreboard, and how many of them the
+ * published snapshot includes. Guarded by the publisher mutex, which the
+ * publisher thread waits on for changes and winners wait on for their
+ * time to be published */
+unsigned long scoreboard_version = 0;
+unsigned long scoreboard_published = 0;
+pthread_mutex_t publisher_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t scoreboard_changed = PTHREAD_COND_INITIALIZER;
+pthread_cond_t scoreboard_caught_up = PTHREAD_COND_INITIALIZER;
 
 /* macOS has different mutex initializers */
 #ifdef __APPLE__
-pthread_mutex_t request_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
 pthread_mutex_t scoreboard_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
-pthread_mutex_t current_users_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
-pthread_mutex_t rand_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
 #else
-pthread_mutex_t request_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 pthread_mutex_t scoreboard_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
-pthread_mutex_t current_users_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
-pthread_mutex_t rand_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 #endif
 
-/* Condition to signal unhandled requests waiting */
-pthread_cond_t requests_outstanding = PTHREAD_COND_INITIALIZER;
+/* Seed that the generator of each thread is derived from, and the
+ * number of threads that have derived one so far */
+#define GAME_SEED 42
+unsigned long game_seed_threads = 0;
 
-/* Thread structures array */
-pthread_t p_threads[QUEUE_SIZE];
+/* Generator of the seeds of new games on the current thread */
+__thread ms_rng_t game_rng;
+__thread bool game_rng_ready = false;
 
 /* Socket for the server to listen on */
 int listen_socket_fd;
 
 /* Function definitions */
-void add_conn_req(int socket_fd, ms_user_t user);
 void add_loss(ms_user_t user);
 void add_score(ms_user_t user, int score);
 void close_server();
 void close_socket(int socket_fd);
-void handle_conn_req(conn_req_t conn_request);
-void handle_conn_reqs_loop(void* data);
-void scoreboard_swap(scoreboard_entry_t *a, scoreboard_entry_t *b);
-void send_game(int socket_fd, ms_game_t game);
-void send_response(int socket_fd, req_t response);
-void send_scoreboard(int socket_fd);
-void sort_leaderboard();
-void user_login(ms_user_t user);
+void game_job_done(ms_job_t *job);
+void game_job_run(ms_job_t *job);
+void handle_request(ms_conn_t *conn, coord_req_t request, const char *payload);
+void handle_batch(ms_conn_t *conn, coord_req_t request, const char *payload);
+void handle_reveal(ms_conn_t *conn, coord_req_t request);
+void handle_session_close(ms_conn_t *conn);
+void handle_session_input(ms_conn_t *conn);
+void login_job_done(ms_job_t *job);
+void login_job_run(ms_job_t *job);
+void no_guess_job_done(ms_job_t *job);
+void no_guess_job_run(ms_job_t *job);
+void raise_file_limit();
+void replace_game(ms_conn_t *conn, req_t outcome, int score);
+void send_changes(ms_conn_t *conn, ms_game_t *game);
+void send_game(ms_conn_t *conn, ms_game_t *game);
+void send_hint(ms_conn_t *conn, ms_game_t *game);
+void send_response(ms_conn_t *conn, req_t response);
+void send_scoreboard(ms_conn_t *conn, ms_scoreboard_query_t query);
+void load_scoreboard(const char *data, size_t len);
+void publish_scoreboard();
+void publisher_loop();
+void scoreboard_wait(unsigned long version);
+void replay_game(ms_journal_record_t *record);
+void save_scoreboard();
+void serialize_scoreboard(ms_buffer_t *buffer, ms_user_t user, ms_scoreboard_query_t query);
+void print_user_contention();
 void user_logout(ms_user_t user);
+void user_stripe_unlock(uint64_t hash);
+
+bool user_login(ms_user_t user);
 
-bool user_logged_in(ms_user_t user);
+ms_user_current_t** user_stripe_lock(uint64_t hash);
 
-req_t request_valid(ms_game_t game, coord_req_t request);
-req_t verify_user(ms_user_t user);
+req_t request_valid(ms_game_t *game, coord_req_t request);
 
-conn_req_t* get_conn_req();
+size_t request_payload_size(coord_req_t request);
 
-coord_req_t receive_user_req(int socket_fd);
+unsigned long scoreboard_change();
 
-ms_user_history_entry_t* find_user_history(ms_user_t user);
+ms_game_t* create_game(ms_config_t config);
+
+ms_user_history_t* record_loss(const char *username);
+ms_user_history_t* record_win(const char *username, int score);
+
+ms_session_job_t* new_session_job(ms_conn_t *conn, job_func_t run, job_func_t done);
+
+void start_login(ms_conn_t *conn);
+void start_timer(ms_session_t *session);
+void start_no_guess(ms_conn_t *conn, coord_req_t request);
 
 
 /***********************************************************************
@@ -100,21 +231,32 @@ ms_user_history_entry_t* find_user_history(ms_user_t user);
 ***********************************************************************/
 int main(int argc, char* argv[]){
 
-    int i;
     struct sockaddr_in server_addr;
+    int enable = 1;
 
     signal(SIGINT, close_server);
     signal(SIGHUP, close_server);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Threads started from here on leave shutting down to the main
+     * thread, which never holds the locks close_server takes */
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    memset(&server_addr, 0, sizeof(struct sockaddr_in));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    /* Choose I/O backend */
+    backend_t backend = epoll_backend;
+    if (argc > 1 && strcmp(argv[argc-1], "--io-uring") == 0){
+        backend = uring_backend;
+        argc--;
+    }
 
-    srand(42);
-
-    /* Thread IDs */
-    int thread_ids[QUEUE_SIZE];
-    
-    /* Thread attributes */
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    
     /* Choose port */
     switch(argc){
         //Server will use default port
@@ -127,21 +269,27 @@ int main(int argc, char* argv[]){
             break;
         //Too many args
         default:
-            printf("\nUsage --> %s [port]\n\n",argv[0]);
+            printf("\nUsage --> %s [port] [--io-uring]\n\n",argv[0]);
             exit(EXIT_FAILURE);
     }
 
+    raise_file_limit();
+
     /* Create socket */
-	if ((listen_socket_fd = socket(AF_INET, SOCK_STREAM, PF_UNSPEC)) == ERROR) {
-		perror("Creating socket");
-		exit(EXIT_FAILURE);
-	}
+    if ((listen_socket_fd = socket(AF_INET, SOCK_STREAM, PF_UNSPEC)) == ERROR) {
+        perror("Creating socket");
+        exit(EXIT_FAILURE);
+    }
+
+    if (setsockopt(listen_socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) == ERROR){
+        perror("Setting SO_REUSEADDR");
+    }
 
     /* Bind socket to server port */
-	if (bind(listen_socket_fd, (struct sockaddr *)&server_addr, sizeof(struct sockaddr)) == ERROR) {
-		perror("Binding socket");
-		exit(EXIT_FAILURE);
-	}
+    if (bind(listen_socket_fd, (struct sockaddr *)&server_addr, sizeof(struct sockaddr)) == ERROR) {
+        perror("Binding socket");
+        exit(EXIT_FAILURE);
+    }
 
     clear_screen();
 
@@ -152,298 +300,637 @@ int main(int argc, char* argv[]){
     fflush(stdout);
 
     /* Start listening on socket port */
-	if (listen(listen_socket_fd, QUEUE_SIZE) == ERROR) {
-		perror("Listening on socket");
-		exit(1);
-	}
-
-    /* Create threads */
-    for (i=0;i<QUEUE_SIZE;i++){
-        thread_ids[i] = i;
-        pthread_create(&p_threads[i], &attr, (void*) handle_conn_reqs_loop, &thread_ids[i]);
-    }
-    
-    /* Listen for connections and add to queue */
+    if (listen(listen_socket_fd, SOMAXCONN) == ERROR) {
+        perror("Listening on socket");
+        exit(1);
+    }
+
+    /* Load the credentials of every user */
+    auth_start("Authentication.txt");
+
+    if (history_init(&user_histories) == ERROR || leaderboard_init(&leaderboard) == ERROR){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Recover the scoreboard saved by previous runs */
+    if (journal_start("scoreboard", load_scoreboard, replay_game) == ERROR){
+        exit(EXIT_FAILURE);
+    }
+    publish_scoreboard();
+    pthread_t publisher;
+    pthread_create(&publisher, NULL, (void*) publisher_loop, NULL);
+    pthread_detach(publisher);
+
+    /* Start one reactor and one compute worker per core */
+    int reactors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (reactors < 1){
+        reactors = 1;
+    }
+    boards_start(GAME_SEED + __atomic_fetch_add(&game_seed_threads, 1, __ATOMIC_RELAXED));
+    pool_start(reactors);
+    backend = reactor_start(reactors, backend, handle_session_input, handle_session_close);
+    printf("Running game sessions on %d %s reactors\n", reactors, backend == uring_backend ? "io_uring" : "epoll");
+    printf("Running compute jobs on %d workers, and %d background workers\n", pool_count(), pool_background_count());
+
+    pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+
+    /* Listen for connections and hand them to the reactors, which
+     * wait for their credentials */
     while (true){
         struct sockaddr_in client_addr;
-        socklen_t sin_size = sizeof(struct sockaddr_in);
 
         int user_fd;
-        ms_user_t user;
 
-        if ((user_fd = accept(listen_socket_fd, (struct sockaddr *)&client_addr, &sin_size)) == ERROR){
+        if ((user_fd = reactor_accept(listen_socket_fd, &client_addr)) == ERROR){
             perror("Accepting message");
             continue;
         }
 
-        /* Receive credentials */
-        if (recv(user_fd, &user, sizeof(ms_user_t), PF_UNSPEC) == ERROR){
-            perror("Receiving user credentials");
+        ms_session_t *session = calloc(1, sizeof(ms_session_t));
+        if (!session){
+            perror("System has run out of memory");
+            close_socket(user_fd);
+            continue;
         }
 
-        switch(verify_user(user)){
-            req_t response;
-            case valid:
-                response = valid;
-                if (send(user_fd, &response, sizeof(int), PF_UNSPEC) == ERROR){
-                    perror("Sending login response");
-                }
-                break;
-            case invalid:
-                response = invalid;
-                if (send(user_fd, &response, sizeof(int), PF_UNSPEC) == ERROR){
-                    perror("Sending login response");
-                }
-                shutdown(user_fd,SHUT_RDWR);
-                close_socket(user_fd);
-                continue;
-            default:
-                break;
+        session->addr = client_addr.sin_addr;
+        session->config = MS_BEGINNER;
+
+        set_low_latency(user_fd);
+
+        if (!reactor_add(user_fd, session, LOGIN_TIMEOUT)){
+            free(session);
+            close_socket(user_fd);
+            continue;
         }
 
-        printf("\nConnection from %s @ %s. ", user.username, inet_ntoa(client_addr.sin_addr));
+    }
 
-        user_login(user);
+    return 0;
+}
 
-        printf("Added user to queue.\n");
-        add_conn_req(user_fd,user);
+/***********************************************************************
+ * func:            A function used to raise the limit on open file
+ *                  descriptors as far as allowed, so that the server
+ *                  can hold many concurrent connections.
+***********************************************************************/
+void raise_file_limit(){
+    struct rlimit limit;
 
+    if (getrlimit(RLIMIT_NOFILE, &limit) == ERROR){
+        perror("Getting file limit");
+        return;
     }
 
-    return 0;
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == ERROR){
+        perror("Raising file limit");
+    }
 }
 
 /***********************************************************************
- * func:            Adds a given connection request to the connections
- *                  linked list.
- * 
- * param socket_fd: The socket file descriptor of the incoming
- *                  connection request.
- * 
- * param user:      The verified user that belongs to the request.
-************************************************************************/
-void add_conn_req(int socket_fd, ms_user_t user){
-    conn_req_t* request;
+ * func:            The function called by a reactor when new input
+ *                  has arrived on a session connection. Every complete
+ *                  request in the input is handled in order, and
+ *                  incomplete requests are left for the next call.
+ * param conn:      The connection of the session.
+***********************************************************************/
+void handle_session_input(ms_conn_t *conn){
 
-    request = (conn_req_t*)malloc(sizeof(conn_req_t));
-    if (!request){
-        perror("System has run out of memory");
+    ms_session_t *session = conn->data;
+    size_t offset = 0;
+    size_t payload_size;
+    coord_req_t request;
+
+    if (!session->logged_in){
+        if (!conn->closing && conn->jobs == 0 && conn->in.len >= sizeof(ms_user_t)){
+            start_login(conn);
+        }
         return;
     }
 
-    request->socket_fd = socket_fd;
-    request->user = user;
-    request->next = NULL;
+    /* Requests wait while a job of the session is running, so that
+     * replies stay in order and see the result of the job */
+    while (!conn->closing && conn->jobs == 0 && conn->in.len - offset >= sizeof(coord_req_t)){
+        memcpy(&request, conn->in.data + offset, sizeof(coord_req_t));
+
+        payload_size = request_payload_size(request);
+        if (conn->in.len - offset - sizeof(coord_req_t) < payload_size){
+            break;
+        }
+
+        handle_request(conn, request, conn->in.data + offset + sizeof(coord_req_t));
+        offset += sizeof(coord_req_t) + payload_size;
+    }
+
+    buffer_consume(&conn->in, offset);
+}
+
+/***********************************************************************
+ * func:            The function called by a reactor when a session
+ *                  connection is about to be closed.
+ * param conn:      The connection of the session.
+***********************************************************************/
+void handle_session_close(ms_conn_t *conn){
 
-    /* Lock request mutex */
-    pthread_mutex_lock(&request_mutex);
+    ms_session_t *session = conn->data;
 
-    if (conn_reqs_num == 0){
-        conn_reqs = request;
-        conn_reqs_last = request;
+    if (session->logged_in){
+        printf("\n%s has left the server\n", session->user.username);
+        fflush(stdout);
+
+        user_logout(session->user);
+    }
+
+    if (session->game){
+        boards_give(session->game);
+    }
+    free(session);
+}
+
+/***********************************************************************
+ * func:            A function used to determine the size of the data
+ *                  that follows a given request.
+ * param request:   The request to check.
+***********************************************************************/
+size_t request_payload_size(coord_req_t request){
+    switch (request.request_type){
+        case configure:
+            return sizeof(ms_config_t);
+        case scoreboard:
+            return sizeof(ms_scoreboard_query_t);
+        case batch:
+            if (request.x > 0 && request.x <= MS_BATCH_MAX){
+                return request.x*sizeof(coord_req_t);
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+/***********************************************************************
+ * func:            The function to handle a request. It handles client
+ *                  requests, updating its internal game state, and
+ *                  queues the respective response.
+ * param conn:      The connection the request arrived on. This holds
+ *                  the session of the request.
+ * param request:   The request to handle.
+ * param payload:   The data following the request, if any.
+***********************************************************************/
+void handle_request(ms_conn_t *conn, coord_req_t request, const char *payload){
+
+    ms_session_t *session = conn->data;
+    ms_config_t config;
+    ms_scoreboard_query_t query;
+    time_t end;
+
+    /* The first game of a session is made when a request first needs
+     * it, unless a configure request has replaced it by then */
+    if (!session->game && request.request_type != configure && request.request_type != scoreboard &&
+            request.request_type != lost && request.request_type != quit){
+        session->game = create_game(session->config);
+    }
+
+    switch (request.request_type){
+        req_t response;
+        case reveal:
+            if (request_valid(session->game, request) != valid){
+                response = invalid;
+                send_response(conn,response);
+            } else if (session->game->first_turn && session->game->config.no_guess){
+                start_no_guess(conn, request);
+            } else {
+                handle_reveal(conn, request);
+            }
+            break;
+        case chord:
+            if (request_valid(session->game, request) != valid){
+                response = invalid;
+                send_response(conn,response);
+            } else {
+                handle_reveal(conn, request);
+            }
+            break;
+        case flag:
+            if (request_valid(session->game, request) == valid){
+                start_timer(session);
+                req_t reveal_response = flag_tile(session->game,request.x,request.y);
+                if (reveal_response == won){
+                    response = won;
+                    send_response(conn, response);
+                    end = time(NULL);
+                    replace_game(conn, won, end-session->start);
+                    break;
+                }
+                send_changes(conn, session->game);
+            } else {
+                response = invalid;
+                send_response(conn,response);
+            }
+            break;
+        case gameboard:
+            send_game(conn, session->game);
+            break;
+        case scoreboard:
+            memcpy(&query, payload, sizeof(ms_scoreboard_query_t));
+            send_scoreboard(conn, query);
+            break;
+        case lost:
+            response = valid;
+            send_response(conn,response);
+            replace_game(conn, lost, 0);
+            break;
+        case configure:
+            memcpy(&config, payload, sizeof(ms_config_t));
+            if (config_valid(config)){
+                session->config = config;
+                replace_game(conn, configure, 0);
+                response = valid;
+            } else {
+                response = invalid;
+            }
+            send_response(conn,response);
+            break;
+        case hint:
+            send_hint(conn, session->game);
+            break;
+        case batch:
+            if (request.x > MS_BATCH_MAX){
+                /* The moves cannot be told apart from requests if unread */
+                conn_close(conn);
+            } else if (request.x <= 0){
+                response = invalid;
+                send_response(conn,response);
+            } else {
+                handle_batch(conn, request, payload);
+            }
+            break;
+        case quit:
+            conn_close(conn);
+            break;
+        default:
+            break;
+    }
+
+}
+
+/***********************************************************************
+ * func:            A function used to reveal a tile of the current game
+ *                  of a session, or the tiles around it for a chord,
+ *                  and queue the response.
+ * param conn:      The connection of the session.
+ * param request:   The valid reveal or chord request.
+***********************************************************************/
+void handle_reveal(ms_conn_t *conn, coord_req_t request){
+
+    ms_session_t *session = conn->data;
+    req_t response;
+    time_t end;
+
+    start_timer(session);
+
+    if (request.request_type == chord){
+        response = chord_tile(session->game,request.x,request.y);
     } else {
-        conn_reqs_last->next = request;
-        conn_reqs_last = request;
+        response = reveal_tile(session->game,request.x,request.y);
     }
+    if (response == lost){
+        send_response(conn,response);
+    } else if (response == won){
+        send_response(conn, response);
+        end = time(NULL);
+        replace_game(conn, won, end-session->start);
+    } else {
+        send_changes(conn, session->game);
+    }
+}
 
-    conn_reqs_num++;
+/***********************************************************************
+ * func:            A function used to apply the moves of a batch to the
+ *                  current game of a session in order, stopping at the
+ *                  first that wins or loses the game, and queue one
+ *                  response for the whole batch. Moves that are not
+ *                  valid are skipped. The first reveal of a no-guess
+ *                  board is not valid in a batch, as its board is found
+ *                  on the compute pool, so must be sent on its own.
+ * param conn:      The connection of the session.
+ * param request:   The batch request, holding the number of moves.
+ * param payload:   The moves.
+***********************************************************************/
+void handle_batch(ms_conn_t *conn, coord_req_t request, const char *payload){
+
+    ms_session_t *session = conn->data;
+    ms_game_t *game = session->game;
+    ms_batch_t result = {0, 0};
+    coord_req_t move;
+    req_t response = valid;
+    time_t end;
+
+    while (result.moves < request.x && response == valid){
+        memcpy(&move, payload + result.moves*sizeof(coord_req_t), sizeof(coord_req_t));
+        result.moves++;
+
+        if (request_valid(game, move) != valid || (move.request_type == reveal && game->first_turn && game->config.no_guess)){
+            result.invalid++;
+            continue;
+        }
 
-    /* Unlock request mutex */
-    pthread_mutex_unlock(&request_mutex);
+        start_timer(session);
 
-    /* Signal that there is now a request outstanding */
-    pthread_cond_signal(&requests_outstanding);
+        switch (move.request_type){
+            case reveal:
+                response = reveal_tile(game, move.x, move.y);
+                break;
+            case chord:
+                response = chord_tile(game, move.x, move.y);
+                break;
+            default:
+                response = flag_tile(game, move.x, move.y);
+                break;
+        }
+        mark_dirty(game);
+    }
+
+    gather_dirty(game);
+
+    buffer_append(&conn->out, &result, sizeof(ms_batch_t));
+    if (response == valid){
+        send_changes(conn, game);
+    } else {
+        send_response(conn, response);
+        if (response == won){
+            end = time(NULL);
+            replace_game(conn, won, end-session->start);
+        }
+    }
+}
+
+/***********************************************************************
+ * func:            A function used to start timing the current game of
+ *                  a session at its first move, so the time taken does
+ *                  not depend on whether the client asks for the board.
+ *                  The timer is stopped when the game is replaced.
+ * param session:   The session making a move.
+***********************************************************************/
+void start_timer(ms_session_t *session){
+    if (!session->timer_started){
+        session->start = time(NULL);
+        session->timer_started = true;
+    }
 }
 
 /***********************************************************************
- * func:            Returns the head of the connection request linked
- *                  list and removes it from the linked list.
+ * func:            A function used to start logging in the session on
+ *                  a given connection, once its credentials have
+ *                  arrived. The credentials are checked on the compute
+ *                  pool. The first game is only made once it is needed,
+ *                  as clients usually configure their own straight
+ *                  after logging in.
+ * param conn:      The connection of the session.
 ***********************************************************************/
-conn_req_t* get_conn_req(){
+void start_login(ms_conn_t *conn){
 
-    conn_req_t* request;
+    ms_session_job_t *job = new_session_job(conn, login_job_run, login_job_done);
 
-    /* Lock request mutex */
-    pthread_mutex_lock(&request_mutex);
+    memcpy(&job->user, conn->in.data, sizeof(ms_user_t));
+    buffer_consume(&conn->in, sizeof(ms_user_t));
 
-    if (conn_reqs_num > 0){
-        request = conn_reqs;
-        conn_reqs = conn_reqs->next;
+    /* Credentials come from the network, so make sure they end */
+    job->user.username[sizeof(job->user.username)-1] = '\0';
+    job->user.password[sizeof(job->user.password)-1] = '\0';
 
-        /* The request was the last of the list */
-        if (conn_reqs == NULL){
-            conn_reqs_last = NULL;
+    pool_submit(&job->job);
+}
+
+/***********************************************************************
+ * func:            The compute side of start_login. Verifies the
+ *                  credentials and logs the user in.
+ * param job:       The job of the session.
+***********************************************************************/
+void login_job_run(ms_job_t *job){
+
+    ms_session_job_t *session_job = (ms_session_job_t*)job;
+
+    session_job->outcome = auth_verify(session_job->user);
+
+    if (session_job->outcome == valid){
+        if (!user_login(session_job->user)){
+            session_job->outcome = invalid;
         }
+    }
+}
 
-        conn_reqs_num--;
+/***********************************************************************
+ * func:            The reactor side of start_login. Starts the session
+ *                  if the login was valid, and closes it otherwise.
+ * param job:       The job of the session.
+***********************************************************************/
+void login_job_done(ms_job_t *job){
+
+    ms_session_job_t *session_job = (ms_session_job_t*)job;
+    ms_session_t *session = job->conn->data;
+
+    send_response(job->conn, session_job->outcome);
 
+    if (session_job->outcome == valid){
+        session->user = session_job->user;
+        session->logged_in = true;
+        conn_set_timeout(job->conn, 0);
+
+        printf("\nConnection from %s @ %s. ", session->user.username, inet_ntoa(session->addr));
+        printf("%s is now playing.\n", session->user.username);
+        fflush(stdout);
     } else {
-        /* The requests list is empty */
-        request = NULL;
+        conn_close(job->conn);
     }
 
-    /* Unlock request mutex */
-    pthread_mutex_unlock(&request_mutex);
+    free(session_job);
+}
+
+/***********************************************************************
+ * func:            A function used to allocate a compute job for the
+ *                  session on a given connection.
+ * param conn:      The connection of the session.
+ * param run:       The function to run on a compute worker.
+ * param done:      The function to run on the reactor afterwards.
+***********************************************************************/
+ms_session_job_t* new_session_job(ms_conn_t *conn, job_func_t run, job_func_t done){
+
+    ms_session_t *session = conn->data;
+    ms_session_job_t *job = calloc(1, sizeof(ms_session_job_t));
+
+    if (!job){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
 
-    return request;
+    job->job.run = run;
+    job->job.done = done;
+    job->job.conn = conn;
+    job->user = session->user;
+    job->config = session->config;
 
+    return job;
 }
 
 /***********************************************************************
- * func:            A loop function which waits for outstanding
- *                  requests. If there is an outstanding request, the
- *                  request will be sent to a handler function.
- * param data:      The data produced by creating a thread.
+ * func:            A function used to end the current game of a
+ *                  session, recording how it ended and replacing it
+ *                  with a new game. The record and the new board are
+ *                  made on the compute pool, and further requests of
+ *                  the session wait until they are done.
+ * param conn:      The connection of the session.
+ * param outcome:   How the game ended, either won, lost or configure
+ *                  if it was abandoned for a new configuration.
+ * param score:     The time taken, if the game was won.
 ***********************************************************************/
-void handle_conn_reqs_loop(void* data){
+void replace_game(ms_conn_t *conn, req_t outcome, int score){
 
-    int thread_id = *((int *)data);
-    conn_req_t* request;
+    ms_session_t *session = conn->data;
+    ms_session_job_t *job = new_session_job(conn, game_job_run, game_job_done);
 
-    pthread_mutex_lock(&request_mutex);
+    job->outcome = outcome;
+    job->score = score;
 
-    while(true){
-        if (conn_reqs_num > 0){
-            request = get_conn_req();
+    session->timer_started = false;
 
-            if (request){
-                pthread_mutex_unlock(&request_mutex);
-                printf("%s now playing in Game Room #%d\n", request->user.username, thread_id+1);
-                fflush(0);
-                handle_conn_req(*request);
-                printf("\n%s has left Game Room #%d\n", request->user.username, thread_id+1);
-                user_logout(request->user);
-                free(request);
-                pthread_mutex_lock(&request_mutex);
-            }
-        } else {
-            pthread_cond_wait(&requests_outstanding, &request_mutex);
-        }
+    pool_submit(&job->job);
+}
+
+/***********************************************************************
+ * func:            The compute side of replace_game. Records the
+ *                  outcome in the scoreboard and generates the board.
+ * param job:       The job of the session.
+***********************************************************************/
+void game_job_run(ms_job_t *job){
+
+    ms_session_job_t *session_job = (ms_session_job_t*)job;
+
+    if (session_job->outcome == won){
+        add_score(session_job->user, session_job->score);
+    } else if (session_job->outcome == lost){
+        add_loss(session_job->user);
     }
 
+    session_job->game = create_game(session_job->config);
 }
 
 /***********************************************************************
- * func:            The function to handle a request. It handles client
- *                  requests, updating its internal game state, and
- *                  sends the respective response.
- * param conn_req:  The connection request to handle. This contains
- *                  the socket information and user information of the
- *                  request.
+ * func:            The reactor side of replace_game. Swaps the new
+ *                  board into the session.
+ * param job:       The job of the session.
+***********************************************************************/
+void game_job_done(ms_job_t *job){
+
+    ms_session_job_t *session_job = (ms_session_job_t*)job;
+    ms_session_t *session = job->conn->data;
+
+    /* A session may end its first game before it was made */
+    if (session->game){
+        boards_give(session->game);
+    }
+    session->game = session_job->game;
+
+    free(session_job);
+}
+
+/***********************************************************************
+ * func:            A function used to start the first reveal of a
+ *                  no-guess game. A board the solver can clear from
+ *                  the revealed tile is searched for on the background
+ *                  workers, and further requests of the session wait
+ *                  until it is found.
+ * param conn:      The connection of the session.
+ * param request:   The valid reveal request.
 ***********************************************************************/
-void handle_conn_req(conn_req_t conn_req){
+void start_no_guess(ms_conn_t *conn, coord_req_t request){
 
-    /* Lock rand mutex */
-    pthread_mutex_lock(&rand_mutex);
+    ms_session_t *session = conn->data;
+    ms_session_job_t *job = new_session_job(conn, no_guess_job_run, no_guess_job_done);
 
-    /* User information for this session */
-    ms_game_t game = new_game(rand());
+    job->request = request;
+    job->seed = session->game->seed;
 
-    /* Unlock rand mutex */
-    pthread_mutex_unlock(&rand_mutex);
+    pool_submit_background(&job->job);
+}
 
-    bool connected = true;
-    time_t start,end;
+/***********************************************************************
+ * func:            The background side of start_no_guess. Searches for
+ *                  the board, starting from the seed of the current one.
+ * param job:       The job of the session.
+***********************************************************************/
+void no_guess_job_run(ms_job_t *job){
 
-    bool timer_started = false;
+    ms_session_job_t *session_job = (ms_session_job_t*)job;
 
-    while (connected){
-        coord_req_t request = receive_user_req(conn_req.socket_fd);
-        switch (request.request_type){
-            req_t response;
-            case reveal:
-                if (request_valid(game, request) == valid){
-                    req_t reveal_response = reveal_tile(&game,request.x,request.y);
-                    if (reveal_response == lost){
-                        response = lost;
-                        send_response(conn_req.socket_fd,response);
-                        break;
-                    } else if (reveal_response == won){
-                        response = won;
-                        send_response(conn_req.socket_fd, response);
-                        end = time(NULL);
-                        int time_taken = end-start;
-                        add_score(conn_req.user,time_taken);
-
-                        /* Lock rand mutex */
-                        pthread_mutex_lock(&rand_mutex);
-
-                        game = new_game(rand());
-
-                        /* Unlock rand mutex */
-                        pthread_mutex_unlock(&rand_mutex);
-                        
-                        timer_started = false;
-                        break;
-                    }
-                    response = valid;
-                    send_response(conn_req.socket_fd,response);
-                } else {
-                    response = invalid;
-                    send_response(conn_req.socket_fd,response);
-                }
-                break;
-            case flag:
-                if (request_valid(game, request) == valid){
-                    req_t reveal_response = flag_tile(&game,request.x,request.y);
-                    if (reveal_response == won){
-                        response = won;
-                        send_response(conn_req.socket_fd, response);
-                        end = time(NULL);
-                        int time_taken = end-start;
-                        add_score(conn_req.user,time_taken);
-
-                        /* Lock rand mutex */
-                        pthread_mutex_lock(&rand_mutex);
-
-                        game = new_game(rand());
-
-                        /* Unlock rand mutex */
-                        pthread_mutex_unlock(&rand_mutex);
-
-                        timer_started = false;
-                        break;
-                    }
-                    response = valid;
-                    send_response(conn_req.socket_fd,response);
-                } else {
-                    response = invalid;
-                    send_response(conn_req.socket_fd,response);
-                }
-                break;
-            case gameboard:
-                if (!timer_started){
-                    start = time(NULL);
-                    timer_started = true;
-                }
-                send_game(conn_req.socket_fd, game);
-                break;
-            case scoreboard:
-                send_scoreboard(conn_req.socket_fd);
-                break;
-            case lost: 
-                timer_started = false;
+    session_job->seed = generator_find(&session_job->config, session_job->seed,
+        session_job->request.x, session_job->request.y);
+}
 
-                /* Lock rand mutex */
-                pthread_mutex_lock(&rand_mutex);
+/***********************************************************************
+ * func:            The reactor side of start_no_guess. Swaps the board
+ *                  found into the session, keeping any flags already
+ *                  placed, then makes the reveal. The board may hold
+ *                  fewer bombs than configured if the search had to
+ *                  relax, which the reply reports.
+ * param job:       The job of the session.
+***********************************************************************/
+void no_guess_job_done(ms_job_t *job){
 
-                game = new_game(rand());
+    ms_session_job_t *session_job = (ms_session_job_t*)job;
+    ms_session_t *session = job->conn->data;
+    ms_game_t *game = new_game(session_job->seed, session_job->config);
+    int x, y;
 
-                /* Unlock rand mutex */
-                pthread_mutex_unlock(&rand_mutex);
+    if (!game){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
 
-                response = valid;
-                send_response(conn_req.socket_fd,response);
-                add_loss(conn_req.user);
-                break;
-            case quit:
-                close_socket(conn_req.socket_fd);
-                return;
-            default:
-                break;
+    for (y=0;y<game->config.rows;y++){
+        for (x=0;x<game->config.cols;x++){
+            if (location_flagged(session->game, x, y)){
+                flag_tile(game, x, y);
+            }
         }
     }
-    
+
+    boards_give(session->game);
+    session->game = game;
+
+    handle_reveal(job->conn, session_job->request);
+
+    free(session_job);
+}
+
+/***********************************************************************
+ * func:            A function used to create a new game state of a
+ *                  given configuration. Boards of the usual
+ *                  difficulties are taken ready made from the board
+ *                  pool, and any others are seeded from the generator
+ *                  of the calling thread.
+ * param config:    The dimensions and bomb count of the board.
+***********************************************************************/
+ms_game_t* create_game(ms_config_t config){
+
+    if (!game_rng_ready){
+        rng_seed(&game_rng, GAME_SEED + __atomic_fetch_add(&game_seed_threads, 1, __ATOMIC_RELAXED));
+        game_rng_ready = true;
+    }
+
+    ms_game_t *game = boards_take(config);
+    if (!game){
+        game = new_game(rng_next(&game_rng), config);
+    }
+
+    if (!game){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    return game;
 }
 
 /***********************************************************************
@@ -453,25 +940,41 @@ void handle_conn_req(conn_req_t conn_req){
  * param game:      The game board state to check.
  * param request:   The request to validate.
 ***********************************************************************/
-req_t request_valid(ms_game_t game, coord_req_t request){
+req_t request_valid(ms_game_t *game, coord_req_t request){
+
+    /* A finished game only waits to be replaced */
+    if (game_over(game)){
+        return invalid;
+    }
 
     switch (request.request_type){
         case reveal:
-            if (!location_valid(&game, request.x, request.y)){
+            if (!location_valid(game, request.x, request.y)){
                 return invalid;
             }
-            if (location_revealed(&game, request.x, request.y)){
+            if (location_revealed(game, request.x, request.y)){
                 return invalid;
             }
-            if (location_flagged(&game,request.x,request.y)){
+            if (location_flagged(game,request.x,request.y)){
                 return invalid;
             }
             return valid;
         case flag:
-            if (!location_valid(&game, request.x, request.y)){
+            if (!location_valid(game, request.x, request.y)){
                 return invalid;
             }
-            if (location_revealed(&game, request.x, request.y)){
+            if (location_revealed(game, request.x, request.y)){
+                return invalid;
+            }
+            return valid;
+        case chord:
+            if (!location_valid(game, request.x, request.y)){
+                return invalid;
+            }
+            if (!location_revealed(game, request.x, request.y)){
+                return invalid;
+            }
+            if (tile_value(game, request.x, request.y) != flags_around(game, request.x, request.y)){
                 return invalid;
             }
             return valid;
@@ -483,123 +986,113 @@ req_t request_valid(ms_game_t game, coord_req_t request){
 
 /***********************************************************************
  * func:            A function used to send a response to a given
- *                  socket connection.
- * param socket_fd: The socket file descriptor of the desired
- *                  connection to send to.
+ *                  connection.
+ * param conn:      The connection to send to.
  * param response:  The response to send.
 ***********************************************************************/
-void send_response(int socket_fd, req_t response){
-    if (send(socket_fd, &response, sizeof(req_t), PF_UNSPEC) == ERROR){
-        perror("Sending request response");
-    }
+void send_response(ms_conn_t *conn, req_t response){
+    buffer_append(&conn->out, &response, sizeof(req_t));
 }
 
 /***********************************************************************
  * func:            A function used to send a game state to a given
- *                  socket connection.
- * param socket_fd: The socket file descriptor of the desired
- *                  connection to send to.
+ *                  connection. The board size, tiles and bombs
+ *                  remaining are serialized into one message.
+ * param conn:      The connection to send to.
  * param game:      The game state to send.
 ***********************************************************************/
-void send_game(int socket_fd, ms_game_t game){
+void send_game(ms_conn_t *conn, ms_game_t *game){
 
-    int cols = MS_COLS;
-    int rows = MS_ROWS;
+    ms_buffer_t *buffer = &conn->out;
 
-    if (send(socket_fd, &cols, sizeof(int), PF_UNSPEC) == ERROR){
-        perror("Sending data packet size");
-    }
+    int cols = game->config.cols;
+    int rows = game->config.rows;
 
-    if (send(socket_fd, &rows, sizeof(int), PF_UNSPEC) == ERROR){
-        perror("Sending data packet size");
-    }
+    buffer_append(buffer, &cols, sizeof(int));
+    buffer_append(buffer, &rows, sizeof(int));
 
     int x,y;
-    uint16_t value;
+    uint16_t *values = buffer_reserve(buffer, cols*rows*sizeof(uint16_t));
 
     for (y=0;y<rows;y++){
         for (x=0;x<cols;x++){
-            if (game.board[x][y].flagged){
-                value = htons(FLAG_VAL);
-            } else if (game.board[x][y].revealed){
-                if (game.board[x][y].bomb){
-                    value = htons(BOMB_VAL);
-                } else {
-                    value = htons(game.board[x][y].adjacent);
-                }
-            } else {
-                value = htons(UNSELECTED_VAL);
-            }
-
-            if (send(socket_fd, &value, sizeof(uint16_t),PF_UNSPEC) == ERROR){
-                perror("Sending game values");
-            };
+            *values++ = htons(tile_value(game, x, y));
         }
     }
 
-    value = htons(bombs_remaining(&game));
-    if (send(socket_fd, &value, sizeof(uint16_t), PF_UNSPEC) == ERROR){
-        perror("Sending bombs remaining");
-    }
+    /* Boards can hold more bombs than 16 bits can count */
+    uint32_t bombs = htonl(bombs_remaining(game));
+    buffer_append(buffer, &bombs, sizeof(uint32_t));
 
 }
 
 /***********************************************************************
- * func:            A function used to recieve and then return a users
- *                  coordinate request.
- * param socket_fd: The socket file descriptor of the desired
- *                  connection to recieve from.
+ * func:            A function used to send a valid response to a move,
+ *                  followed by the tiles altered by the move and the
+ *                  bombs remaining, as one message.
+ * param conn:      The connection to send to.
+ * param game:      The game state to send the changes of.
 ***********************************************************************/
-coord_req_t receive_user_req(int socket_fd){
-    coord_req_t request;
+void send_changes(ms_conn_t *conn, ms_game_t *game){
+
+    ms_buffer_t *buffer = &conn->out;
+
+    int i, x, y;
+    int count = game->changed_num;
+    req_t response = valid;
 
-    if (recv(socket_fd, &request, sizeof(coord_req_t),PF_UNSPEC) == ERROR){
-        perror("Receiving user coord request");
+    buffer_append(buffer, &response, sizeof(req_t));
+    buffer_append(buffer, &count, sizeof(int));
+
+    ms_tile_update_t *updates = buffer_reserve(buffer, count*sizeof(ms_tile_update_t));
+
+    for (i=0;i<count;i++){
+        x = game->changed[i] % game->config.cols;
+        y = game->changed[i] / game->config.cols;
+        updates[i].x = htons(x);
+        updates[i].y = htons(y);
+        updates[i].value = htons(tile_value(game, x, y));
     }
 
-    return request;
+    uint32_t bombs = htonl(bombs_remaining(game));
+    buffer_append(buffer, &bombs, sizeof(uint32_t));
 }
 
 /***********************************************************************
- * func:            A function used to validate a user based on the
- *                  usernames and passwords stored in the file
- *                  "Authentication.txt".
- * param user:      The user to validate.
+ * func:            A function used to send a valid response to a hint
+ *                  request, followed by the hint for the current state
+ *                  of a game, as one message. The chances of a bomb on
+ *                  each tile are only sent if no tile is proven safe.
+ * param conn:      The connection to send to.
+ * param game:      The game state to send a hint for.
 ***********************************************************************/
-req_t verify_user(ms_user_t user){
+void send_hint(ms_conn_t *conn, ms_game_t *game){
 
-    if (user_logged_in(user)){
-        return invalid;
-    }
-    
-    FILE *auth_file = fopen("Authentication.txt","r");
-    char buffer[256];
+    ms_buffer_t *buffer = &conn->out;
+    ms_solver_hint_t result;
+    ms_hint_t header;
+    req_t response = valid;
+    int i;
 
-    int i = 0;
+    solver_hint(game, &result);
 
-    if (!auth_file){
-        printf("No authentication file found\n");
-        return invalid;
-    }
+    header.x = result.safe == -1 ? -1 : result.safe % game->config.cols;
+    header.y = result.safe == -1 ? -1 : result.safe / game->config.cols;
+    header.interior = result.interior < 0 ? -1 : (int)(result.interior*10000 + 0.5);
+    header.count = result.safe == -1 ? result.count : 0;
 
-    while (fgets(buffer,256, auth_file)!=NULL)
-        /* Dont read column headers */
-        if (i==0){
-            i++;
-        } else {
-            char *token = strtok(buffer,"\t\n\r ");
-            /* If the username is correct, then check the password */
-            if (strcmp(user.username,token) == 0){
-                token = strtok(NULL, "\t\n\r ");
-                if (strcmp(user.password,token) == 0){
-                    fclose(auth_file);
-                    return valid;
-                }
-            }
-        }	
+    buffer_append(buffer, &response, sizeof(req_t));
+    buffer_append(buffer, &header, sizeof(ms_hint_t));
+
+    ms_tile_update_t *updates = buffer_reserve(buffer, header.count*sizeof(ms_tile_update_t));
 
-    fclose(auth_file);
-    return invalid;
+    for (i=0;i<header.count;i++){
+        updates[i].x = htons(result.tiles[i] % game->config.cols);
+        updates[i].y = htons(result.tiles[i] / game->config.cols);
+        updates[i].value = htons(result.chances[i]*10000 + 0.5);
+    }
+
+    solver_hint_free(&result);
 }
 
 /***********************************************************************
@@ -611,84 +1104,232 @@ void add_loss(ms_user_t user){
     /* Lock scoreboard mutex */
     pthread_mutex_lock(&scoreboard_mutex);
 
-    ms_user_history_entry_t* pointer = find_user_history(user);
-    pointer->user.lost++;
+    ms_user_history_t* history = record_loss(user.username);
+    if (history){
+        if (journal_append(lost, 0, user.username)){
+            save_scoreboard();
+        }
+
+        /* Games played are shown next to each of their times */
+        if (history->best){
+            scoreboard_change();
+        }
+    }
 
     /* Unlock scoreboard mutex */
     pthread_mutex_unlock(&scoreboard_mutex);
 }
 
+/***********************************************************************
+ * func:            A function used to add a score to the servers
+ *                  scoreboard.
+ * param user:      The user associated with the achieved score.
+ * param score:     The time taken to complete the game.
+***********************************************************************/
+void add_score(ms_user_t user, int score){
+
+    unsigned long version = 0;
+
+    /* Lock scoreboard mutex */
+    pthread_mutex_lock(&scoreboard_mutex);
+
+    if (record_win(user.username, score)){
+        if (journal_append(won, score, user.username)){
+            save_scoreboard();
+        }
+        version = scoreboard_change();
+    }
+
+    /* Unlock scoreboard mutex */
+    pthread_mutex_unlock(&scoreboard_mutex);
+
+    /* The winner is answered once their time can be seen */
+    scoreboard_wait(version);
+
+    printf("\nTime of %d added\n", score);
+
+}
 
 /***********************************************************************
- * func:            A function used to find a specified user in the
- *                  user history linked list.
- * param user:      The specified user to retrieve.
+ * func:            A function used to add a loss to the history of a
+ *                  given user. Returns the history, or NULL if the
+ *                  system has run out of memory. Called with
+ *                  scoreboard_mutex held.
+ * param username:  The user who lost.
 ***********************************************************************/
-ms_user_history_entry_t* find_user_history(ms_user_t user){
-    ms_user_history_entry_t* pointer = user_histories;
+ms_user_history_t* record_loss(const char *username){
+
+    ms_user_history_t* history = history_find(&user_histories, username);
 
-    if (pointer == NULL){
-        pointer = malloc(sizeof(ms_user_history_entry_t));
-        pointer->user.user = user;
-        pointer->user.won = 0;
-        pointer->user.lost = 0;
-        user_histories = pointer;
-        return pointer;
+    if (!history){
+        perror("System has run out of memory");
+        return NULL;
     }
 
-    for(;pointer!=NULL;pointer=pointer->next){
-        if (strcmp(user.username, pointer->user.user.username) == 0){
-            return pointer;
-        }
-        if (pointer->next == NULL){
-            pointer->next = malloc(sizeof(ms_user_history_entry_t));
-            pointer->next->user.user = user;
-            pointer->next->user.won = 0;
-            pointer->next->user.lost = 0;
-            return pointer->next;
+    history->lost++;
+
+    return history;
+}
+
+/***********************************************************************
+ * func:            A function used to add a win to the history of a
+ *                  given user, and its time to the leaderboard. Returns
+ *                  the history, or NULL if the system has run out of
+ *                  memory. Called with scoreboard_mutex held.
+ * param username:  The user who won.
+ * param score:     The time taken to complete the game.
+***********************************************************************/
+ms_user_history_t* record_win(const char *username, int score){
+
+    /* Add a win to user history */
+    ms_user_history_t* history = history_find(&user_histories, username);
+    ms_leader_t* leader = NULL;
+
+    /* Add time to leaderboard, ordered by the wins at this point. With
+     * more wins, a new entry goes after any equal time of the user */
+    if (history){
+        history->won++;
+        leader = leaderboard_insert(&leaderboard, history, score, history->won);
+    }
+    if (!leader){
+        perror("System has run out of memory");
+        return NULL;
+    }
+
+    if (!history->best || score <= history->best->seconds_taken){
+        history->best = leader;
+    }
+
+    return history;
+}
+
+/***********************************************************************
+ * func:            A function used to apply a game logged by a previous
+ *                  run of the server while recovering the scoreboard.
+ * param record:    The logged game.
+***********************************************************************/
+void replay_game(ms_journal_record_t *record){
+
+    char username[MAX_USERNAME_LEN];
+
+    memcpy(username, record->username, MAX_USERNAME_LEN);
+    username[MAX_USERNAME_LEN-1] = '\0';
+
+    if (record->outcome == won){
+        record_win(username, record->seconds_taken);
+    } else if (record->outcome == lost){
+        record_loss(username);
+    }
+}
+
+/***********************************************************************
+ * func:            A function used to hand a copy of the whole
+ *                  scoreboard to the journal, which saves it in place
+ *                  of the games logged so far. Called with
+ *                  scoreboard_mutex held.
+***********************************************************************/
+void save_scoreboard(){
+
+    ms_buffer_t body;
+    ms_saved_scoreboard_t *header;
+    ms_saved_user_t *user;
+    ms_saved_leader_t *saved;
+    ms_user_history_t *history;
+    ms_leader_t *pointer;
+    uint32_t index = 0;
+    size_t i;
+
+    memset(&body, 0, sizeof(ms_buffer_t));
+
+    header = buffer_reserve(&body, sizeof(ms_saved_scoreboard_t) +
+        user_histories.count*sizeof(ms_saved_user_t) + leaderboard.length*sizeof(ms_saved_leader_t));
+
+    header->users = user_histories.count;
+    header->leaders = leaderboard.length;
+
+    user = (ms_saved_user_t*)(header+1);
+    for (i=0;i<=user_histories.mask;i++){
+        for (history=user_histories.buckets[i];history!=NULL;history=history->next,user++){
+            memset(user, 0, sizeof(ms_saved_user_t));
+            user->won = history->won;
+            user->lost = history->lost;
+            snprintf(user->username, MAX_USERNAME_LEN, "%s", history->username);
+            history->index = index++;
         }
     }
 
-    return NULL;
+    saved = (ms_saved_leader_t*)user;
+    for (pointer=leaderboard_first(&leaderboard);pointer!=NULL;pointer=leaderboard_next(pointer),saved++){
+        saved->seconds_taken = pointer->seconds_taken;
+        saved->wins = pointer->wins;
+        saved->user = pointer->history->index;
+    }
+
+    journal_snapshot(&body);
 }
 
 /***********************************************************************
- * func:            A function used to add a score to the servers
- *                  scoreboard.
- * param user:      The user associated with the achieved score.
- * param score:     The time taken to complete the game.
+ * func:            A function used to rebuild the scoreboard from one
+ *                  saved by save_scoreboard. The entries are saved in
+ *                  display order, so each goes straight on the end of
+ *                  the leaderboard.
+ * param data:      The saved scoreboard.
+ * param len:       The length of the saved scoreboard.
 ***********************************************************************/
-void add_score(ms_user_t user, int score){
+void load_scoreboard(const char *data, size_t len){
+
+    const ms_saved_scoreboard_t *header = (const ms_saved_scoreboard_t*)data;
+    const ms_saved_user_t *user;
+    const ms_saved_leader_t *saved;
+    ms_user_history_t **histories, *history;
+    ms_leader_t *leader;
+    char username[MAX_USERNAME_LEN];
+    size_t i;
+
+    if (len < sizeof(ms_saved_scoreboard_t) || len != sizeof(ms_saved_scoreboard_t) +
+            header->users*sizeof(ms_saved_user_t) + header->leaders*sizeof(ms_saved_leader_t)){
+        printf("Ignoring a saved scoreboard of the wrong size\n");
+        return;
+    }
 
-    /* Lock scoreboard mutex */
-    pthread_mutex_lock(&scoreboard_mutex);
+    histories = malloc(header->users*sizeof(ms_user_history_t*) + 1);
+    if (!histories){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
 
-    /* Add a win to user history */
-    ms_user_history_entry_t* uh_pointer = find_user_history(user);
-    uh_pointer->user.won++;
-    
-    /* Add time to scoreboard */
-    scoreboard_entry_t* entry = malloc(sizeof(scoreboard_entry_t));
-
-    entry->seconds_taken = score;
-    entry->user = user;
-
-    if (scoreboard_entry_num== 0){
-        scoreboard_entries = entry;
-        scoreboard_entries_last = entry;
-    } else {
-        scoreboard_entries_last->next = entry;
-        scoreboard_entries_last = entry;
+    user = (const ms_saved_user_t*)(header+1);
+    for (i=0;i<header->users;i++,user++){
+        memcpy(username, user->username, MAX_USERNAME_LEN);
+        username[MAX_USERNAME_LEN-1] = '\0';
+
+        if (!(histories[i] = history_find(&user_histories, username))){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+        histories[i]->won = user->won;
+        histories[i]->lost = user->lost;
     }
 
-    sort_leaderboard();
+    saved = (const ms_saved_leader_t*)user;
+    for (i=0;i<header->leaders;i++,saved++){
+        if (saved->user >= header->users){
+            continue;
+        }
+        history = histories[saved->user];
 
-    /* Unlock scoreboard mutex */
-    pthread_mutex_unlock(&scoreboard_mutex);
+        if (!(leader = leaderboard_append(&leaderboard, history, saved->seconds_taken, saved->wins))){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
 
-    scoreboard_entry_num++;
-    printf("\nTime of %d added\n", score);
+        /* Later entries of a user with the same time are newer */
+        if (!history->best || leader->seconds_taken <= history->best->seconds_taken){
+            history->best = leader;
+        }
+    }
 
+    free(histories);
 }
 
 /***********************************************************************
@@ -706,6 +1347,10 @@ void close_socket(int socket_fd){
  * func:            A function used to properly close the server state.
 ***********************************************************************/
 void close_server(){
+    journal_stop();
+    print_user_contention();
+    boards_report();
+    generator_report();
     printf("\nServer is shutting down now...\n");
     shutdown(listen_socket_fd, SHUT_RDWR);
     close(listen_socket_fd);
@@ -713,176 +1358,325 @@ void close_server(){
 }
 
 /***********************************************************************
- * func:            A function used to send the current scoreboard to
- *                  a given connection.
- * param socket_fd: The socket file descriptor of the specified
- *                  connection.
+ * func:            A function used to send a page of the current
+ *                  scoreboard to a given connection. Reading the
+ *                  published snapshot never waits on a writer, so the
+ *                  page is serialized straight onto the connection.
+ * param conn:      The connection to send to.
+ * param query:     The page to send.
 ***********************************************************************/
-void send_scoreboard(int socket_fd){
-    
-    int i;
-    scoreboard_entry_t *pointer = scoreboard_entries;
+void send_scoreboard(ms_conn_t *conn, ms_scoreboard_query_t query){
+    serialize_scoreboard(&conn->out, ((ms_session_t*)conn->data)->user, query);
+}
 
-    if (send(socket_fd, &scoreboard_entry_num, sizeof(int), PF_UNSPEC) == ERROR){
-        perror("Sending scoreboard size");
+/***********************************************************************
+ * func:            A function used to serialize a page of the current
+ *                  scoreboard into a given buffer. The page is a single
+ *                  run of the published snapshot, so the cost follows
+ *                  the page size rather than the size of the scoreboard,
+ *                  apart from the occasional query that replaces a
+ *                  stale snapshot.
+ * param buffer:    The buffer to append to.
+ * param user:      The user asking, for around queries.
+ * param query:     The page to serialize.
+***********************************************************************/
+void serialize_scoreboard(ms_buffer_t *buffer, ms_user_t user, ms_scoreboard_query_t query){
+
+    ms_scoreboard_snapshot_t *snapshot;
+    ms_scoreboard_page_t page;
+    uint64_t hash;
+    size_t i;
+    int limit, first = 0;
+
+    limit = query.limit < 0 ? 0 : query.limit;
+    if (limit > SCOREBOARD_PAGE_MAX){
+        limit = SCOREBOARD_PAGE_MAX;
     }
 
-    if (scoreboard_entry_num == 0){
-        return;
+    epoch_enter();
+
+    snapshot = __atomic_load_n(&scoreboard_snapshot, __ATOMIC_SEQ_CST);
+    page.total = snapshot ? snapshot->total : 0;
+
+    /* Ranks count from the best entry, which is last in display order.
+     * First is the number of ranks skipped before the page */
+    switch (query.type){
+        case range_query:
+            first = query.offset < 0 ? 0 : query.offset;
+            break;
+        case around_query:
+            if (!snapshot){
+                break;
+            }
+            hash = hash_string(user.username);
+            for (i=hash & snapshot->mask;snapshot->slots[i].index!=ERROR;i=(i+1) & snapshot->mask){
+                if (snapshot->slots[i].hash == hash &&
+                        strcmp(snapshot->entries[snapshot->slots[i].index].username, user.username) == 0){
+                    first = page.total - 1 - snapshot->slots[i].index - limit/2;
+                    break;
+                }
+            }
+            if (first > page.total - limit){
+                first = page.total - limit;
+            }
+            break;
+        default:
+            break;
     }
-    
-    for (i=0;i<scoreboard_entry_num;i++){
-        if (send(socket_fd, pointer, sizeof(scoreboard_entry_t), PF_UNSPEC) == ERROR){
-            perror("Sending scoreboard entry");
-        }
-        if (send(socket_fd, find_user_history(pointer->user), sizeof(ms_user_history_entry_t), PF_UNSPEC) == ERROR){
-            perror("Receiving scoreboard entry");
-        }
-        pointer = pointer->next;
+    if (first > page.total){
+        first = page.total;
     }
+    if (first < 0){
+        first = 0;
+    }
+
+    page.count = page.total - first < limit ? page.total - first : limit;
+    page.first_rank = page.count ? first + 1 : 0;
+    buffer_append(buffer, &page, sizeof(ms_scoreboard_page_t));
+
+    /* The entries are already in display order, worst rank first */
+    if (page.count){
+        buffer_append(buffer, &snapshot->entries[page.total - first - page.count], page.count*sizeof(ms_score_t));
+    }
+
+    epoch_exit();
 
 }
 
 /***********************************************************************
- * func:            A function used to swap two given scoreboard
- *                  entries in the servers leaderboard state.
- * param a:         A scoreboard entry to be swapped.
- * param b:         The other scoreboard entry to be swapped.
+ * func:            A function used to record a change to the
+ *                  scoreboard and wake the publisher thread. Called
+ *                  with scoreboard_mutex held, so versions are in the
+ *                  order of the changes. Returns the version that
+ *                  includes the change.
 ***********************************************************************/
-void scoreboard_swap(scoreboard_entry_t *a, scoreboard_entry_t *b){
-    ms_user_t user_temp = a->user;
-    int time_temp = a->seconds_taken;
+unsigned long scoreboard_change(){
+
+    unsigned long version;
 
-    a->user = b->user;
-    a->seconds_taken = b->seconds_taken;
+    pthread_mutex_lock(&publisher_mutex);
+    version = ++scoreboard_version;
+    pthread_cond_signal(&scoreboard_changed);
+    pthread_mutex_unlock(&publisher_mutex);
 
-    b->user = user_temp;
-    b->seconds_taken = time_temp;
+    return version;
 }
 
 /***********************************************************************
- * func:            A function used to sort the leaderboard, with
- *                  regards to predefined specifications. This is
- *                  achieved using a Bubblesort algorithm.
+ * func:            A function used to wait until the published
+ *                  snapshot includes a given version of the scoreboard.
+ * param version:   The version to wait for, 0 to not wait.
 ***********************************************************************/
-void sort_leaderboard(){
+void scoreboard_wait(unsigned long version){
 
-    int swapped;
-    scoreboard_entry_t* ptr1;
-    scoreboard_entry_t* last = NULL;
+    pthread_mutex_lock(&publisher_mutex);
+    while (scoreboard_published < version){
+        pthread_cond_wait(&scoreboard_caught_up, &publisher_mutex);
+    }
+    pthread_mutex_unlock(&publisher_mutex);
+}
+
+/***********************************************************************
+ * func:            The loop of the publisher thread, which copies the
+ *                  scoreboard whenever it has changed. Changes made
+ *                  while a copy is taken are published together by the
+ *                  next one, so a burst of games costs a single copy
+ *                  and readers never make one.
+***********************************************************************/
+void publisher_loop(){
+
+    unsigned long version;
+
+    while (true){
+        pthread_mutex_lock(&publisher_mutex);
+        while (scoreboard_published == scoreboard_version){
+            pthread_cond_wait(&scoreboard_changed, &publisher_mutex);
+        }
+        pthread_mutex_unlock(&publisher_mutex);
+
+        /* Changes are versioned under the scoreboard mutex, so the copy
+         * includes every version up to the one read here */
+        pthread_mutex_lock(&scoreboard_mutex);
+        pthread_mutex_lock(&publisher_mutex);
+        version = scoreboard_version;
+        pthread_mutex_unlock(&publisher_mutex);
+        publish_scoreboard();
+        pthread_mutex_unlock(&scoreboard_mutex);
+
+        pthread_mutex_lock(&publisher_mutex);
+        scoreboard_published = version;
+        pthread_cond_broadcast(&scoreboard_caught_up);
+        pthread_mutex_unlock(&publisher_mutex);
+    }
+}
+
+/***********************************************************************
+ * func:            A function used to replace the published snapshot
+ *                  with a copy of the current scoreboard. The old
+ *                  snapshot is freed once no reader holds it. If the
+ *                  system has run out of memory, the old one is kept
+ *                  until the next change. Called with scoreboard_mutex
+ *                  held.
+***********************************************************************/
+void publish_scoreboard(){
+
+    ms_scoreboard_snapshot_t *snapshot, *old;
+    ms_user_history_t *history;
+    ms_leader_t *pointer;
+    ms_score_t *score;
+    size_t slots, i;
+    int total = leaderboard.length, index;
 
-    if (scoreboard_entries == NULL){
+    /* Only the best entry of each user is indexed, but there can be
+     * as many users as entries */
+    slots = hash_slots(total);
+
+    snapshot = calloc(1, sizeof(ms_scoreboard_snapshot_t) + total*sizeof(ms_score_t) + slots*sizeof(ms_scoreboard_slot_t));
+    if (!snapshot){
+        perror("System has run out of memory");
         return;
     }
 
-    do {
-        swapped = 0;
-        ptr1 = scoreboard_entries;
-
-        while (ptr1->next != last){
-            if (ptr1->seconds_taken < ptr1->next->seconds_taken){
-                scoreboard_swap(ptr1, ptr1->next);
-                swapped = 1;
-            } else if (ptr1->seconds_taken == ptr1->next->seconds_taken){
-                if (find_user_history(ptr1->user)->user.won > find_user_history(ptr1->next->user)->user.won){
-                    scoreboard_swap(ptr1, ptr1->next);
-                    swapped = 1;
-                } else if (strcasecmp(ptr1->user.username,ptr1->next->user.username) > 0){
-                    scoreboard_swap(ptr1, ptr1->next);
-                    swapped = 1;
-                }
-            }
-            ptr1 = ptr1->next;
+    snapshot->total = total;
+    snapshot->mask = slots-1;
+    snapshot->slots = (ms_scoreboard_slot_t*)&snapshot->entries[total];
+    for (i=0;i<slots;i++){
+        snapshot->slots[i].index = ERROR;
+    }
+
+    pointer = leaderboard_first(&leaderboard);
+    for (index=0;index<total;index++,pointer=leaderboard_next(pointer)){
+        history = pointer->history;
+
+        score = &snapshot->entries[index];
+        score->rank = total - index;
+        score->seconds_taken = pointer->seconds_taken;
+        score->won = history->won;
+        score->played = history->won + history->lost;
+        snprintf(score->username, MAX_USERNAME_LEN, "%s", history->username);
+
+        if (history->best == pointer){
+            for (i=history->hash & snapshot->mask;snapshot->slots[i].index!=ERROR;i=(i+1) & snapshot->mask);
+            snapshot->slots[i].hash = history->hash;
+            snapshot->slots[i].index = index;
         }
-        last = ptr1;
-    } while (swapped);
+    }
 
+    old = __atomic_exchange_n(&scoreboard_snapshot, snapshot, __ATOMIC_SEQ_CST);
+    if (old){
+        epoch_retire(old, free);
+    }
 }
 
 /***********************************************************************
- * func:            A function used to determine whether a given user
- *                  is currently logged into the server.
- * param user:      The specified user to check.
+ * func:            A function used to lock the stripe of the logged in
+ *                  users hash set holding a given hash, counting the
+ *                  lock as contended if it had to wait. Returns the
+ *                  bucket of the hash.
+ * param hash:      The hash of the username.
 ***********************************************************************/
-bool user_logged_in(ms_user_t user){
+ms_user_current_t** user_stripe_lock(uint64_t hash){
 
-    /* Lock current users mutex */
-    pthread_mutex_lock(&current_users_mutex);
+    ms_user_stripe_t *stripe = &current_users_stripes[hash & (USER_STRIPES-1)];
+    bool contended = false;
 
-    ms_user_current_t *pointer = current_users;
-
-    while (pointer!=NULL){
-        if (strcmp(user.username, pointer->user.username) == 0){
-            /* Unlock current users mutex */
-            pthread_mutex_unlock(&current_users_mutex);
-            return true;
-        }
-        pointer = pointer->next;
+    if (pthread_mutex_trylock(&stripe->mutex) != 0){
+        pthread_mutex_lock(&stripe->mutex);
+        contended = true;
     }
 
-    /* Unlock current users mutex */
-    pthread_mutex_unlock(&current_users_mutex);
-    return false;
+    stripe->locks++;
+    stripe->contended += contended;
+
+    return &current_users[hash & (USER_BUCKETS-1)];
+}
+
+/***********************************************************************
+ * func:            A function used to unlock the stripe of the logged
+ *                  in users hash set holding a given hash.
+ * param hash:      The hash of the username.
+***********************************************************************/
+void user_stripe_unlock(uint64_t hash){
+    pthread_mutex_unlock(&current_users_stripes[hash & (USER_STRIPES-1)].mutex);
 }
 
 /***********************************************************************
  * func:            A function used to log a user into the systems
- *                  linked list, so that their connection state may be
- *                  monitored throughout the session.
+ *                  hash set, so that their connection state may be
+ *                  monitored throughout the session. Returns false if
+ *                  the user is already logged in.
  * param user:      The specified user to log in.
 ***********************************************************************/
-void user_login(ms_user_t user){
+bool user_login(ms_user_t user){
 
-    /* Lock current users mutex */
-    pthread_mutex_lock(&current_users_mutex);
+    uint64_t hash = hash_string(user.username);
+    ms_user_current_t **bucket = user_stripe_lock(hash);
+    ms_user_current_t *pointer;
 
-    ms_user_current_t *pointer = malloc(sizeof(ms_user_current_t));
+    for (pointer=*bucket;pointer!=NULL;pointer=pointer->next){
+        if (pointer->hash == hash && strcmp(user.username, pointer->user.username) == 0){
+            user_stripe_unlock(hash);
+            return false;
+        }
+    }
+
+    pointer = malloc(sizeof(ms_user_current_t));
+    if (!pointer){
+        user_stripe_unlock(hash);
+        perror("System has run out of memory");
+        return false;
+    }
 
     pointer->user = user;
-    pointer->next = current_users;
+    pointer->hash = hash;
+    pointer->next = *bucket;
 
-    current_users = pointer;
+    *bucket = pointer;
 
-    /* Unlock current users mutex */
-    pthread_mutex_unlock(&current_users_mutex);
+    user_stripe_unlock(hash);
 
+    return true;
 }
 
 /***********************************************************************
  * func:            A function used to log a user out of the systems
- *                  connection linked list.
+ *                  hash set.
  * param user:      The specified user to log out.
 ***********************************************************************/
 void user_logout(ms_user_t user){
 
-    ms_user_current_t *current = current_users;
-    ms_user_current_t *delete = NULL;
-
-    /* Lock current users mutex */
-    pthread_mutex_lock(&current_users_mutex);
-
-    if (strcmp(current->user.username, user.username) == 0){
-        current_users = current->next;
-        free(current);
-        pthread_mutex_unlock(&current_users_mutex);
-        return;
-    }
+    uint64_t hash = hash_string(user.username);
+    ms_user_current_t **link = user_stripe_lock(hash);
+    ms_user_current_t *delete;
 
-    while (current != NULL){
-        if (strcmp(current->next->user.username, user.username) == 0){
-            delete = current->next;
-            if (delete->next == NULL){
-                current->next = NULL;
-            } else {
-                current->next = delete->next;
-            }
+    for (;*link!=NULL;link=&(*link)->next){
+        if ((*link)->hash == hash && strcmp((*link)->user.username, user.username) == 0){
+            delete = *link;
+            *link = delete->next;
             free(delete);
-            pthread_mutex_unlock(&current_users_mutex);
-            return;
+            break;
         }
-        current = current->next;
     }
 
-    /* Unlock current users mutex */
-    pthread_mutex_unlock(&current_users_mutex);
-}
\ No newline at end of file
+    user_stripe_unlock(hash);
+}
+
+/***********************************************************************
+ * func:            A function used to print how often the locks of the
+ *                  logged in users hash set were taken, and how often
+ *                  that meant waiting for another thread.
+***********************************************************************/
+void print_user_contention(){
+
+    int i;
+    unsigned long locks = 0;
+    unsigned long contended = 0;
+
+    for (i=0;i<USER_STRIPES;i++){
+        locks += __atomic_load_n(&current_users_stripes[i].locks, __ATOMIC_RELAXED);
+        contended += __atomic_load_n(&current_users_stripes[i].contended, __ATOMIC_RELAXED);
+    }
+
+    printf("\nLogged in users: %lu locks taken across %d stripes, %lu contended (%.3f%%)\n",
+        locks, USER_STRIPES, contended, locks ? 100.0*contended/locks : 0.0);
+}
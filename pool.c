@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Compute pool definitions */
+#include "pool.h"
+/* Reactor definitions */
+#include "reactor.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* A struct representing a single compute worker and its deque of jobs.
+ * The owner pushes and pops at the bottom, thieves take from the top */
+typedef struct{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    ms_job_t **jobs;            /* Ring of jobs, a power of two in size */
+    size_t size;
+    size_t top;                 /* Oldest job, taken by thieves */
+    size_t bottom;              /* Slot after the newest job */
+} ms_worker_t;
+
+/* The running workers */
+ms_worker_t *workers = NULL;
+int workers_num = 0;
+
+/* Worker that will be given the next job submitted from outside */
+unsigned int worker_next = 0;
+
+/* The worker running on the current thread, if any */
+__thread ms_worker_t *worker_self = NULL;
+
+/* Jobs submitted but not yet taken, and the sleep of idle workers */
+int jobs_pending = 0;
+pthread_mutex_t idle_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+
+/* Background jobs waiting for a background worker, oldest first, and
+ * the number of background workers running */
+ms_job_t *background_head = NULL;
+ms_job_t *background_tail = NULL;
+int background_num = 0;
+pthread_mutex_t background_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t background_cond = PTHREAD_COND_INITIALIZER;
+
+/* Function definitions */
+void background_loop();
+void worker_loop(ms_worker_t *worker);
+void worker_push(ms_worker_t *worker, ms_job_t *job);
+
+ms_job_t* worker_pop(ms_worker_t *worker);
+ms_job_t* worker_steal(ms_worker_t *worker);
+
+int pool_count(){
+    return workers_num;
+}
+
+int pool_background_count(){
+    return background_num;
+}
+
+void pool_start(int count){
+    int i;
+
+    workers = calloc(count, sizeof(ms_worker_t));
+    if (!workers){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i=0;i<count;i++){
+        pthread_mutex_init(&workers[i].mutex, NULL);
+        workers[i].size = POOL_DEQUE_SIZE;
+        workers[i].jobs = malloc(POOL_DEQUE_SIZE*sizeof(ms_job_t*));
+        if (!workers[i].jobs){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    workers_num = count;
+
+    for (i=0;i<count;i++){
+        pthread_create(&workers[i].thread, NULL, (void*) worker_loop, &workers[i]);
+    }
+
+    background_num = count;
+
+    for (i=0;i<count;i++){
+        pthread_t thread;
+        pthread_create(&thread, NULL, (void*) background_loop, NULL);
+        pthread_detach(thread);
+    }
+}
+
+void pool_submit(ms_job_t *job){
+
+    ms_worker_t *worker = worker_self;
+
+    if (job->conn){
+        job->conn->jobs++;
+    }
+
+    if (!worker){
+        worker = &workers[__atomic_fetch_add(&worker_next, 1, __ATOMIC_RELAXED) % workers_num];
+    }
+
+    /* Count the job first, so a worker that sees it pending keeps looking */
+    __atomic_fetch_add(&jobs_pending, 1, __ATOMIC_SEQ_CST);
+    worker_push(worker, job);
+
+    pthread_mutex_lock(&idle_mutex);
+    pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_mutex);
+}
+
+void pool_submit_background(ms_job_t *job){
+
+    if (job->conn){
+        job->conn->jobs++;
+    }
+
+    job->next = NULL;
+
+    pthread_mutex_lock(&background_mutex);
+    if (background_tail){
+        background_tail->next = job;
+    } else {
+        background_head = job;
+    }
+    background_tail = job;
+    pthread_cond_signal(&background_cond);
+    pthread_mutex_unlock(&background_mutex);
+}
+
+/***********************************************************************
+ * func:            The loop of a single background worker. Lowers its
+ *                  own priority, then runs background jobs in the
+ *                  order they were submitted, sleeping while there are
+ *                  none.
+***********************************************************************/
+void background_loop(){
+
+    ms_job_t *job;
+
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), POOL_BACKGROUND_NICE);
+
+    while (true){
+        pthread_mutex_lock(&background_mutex);
+        while (!background_head){
+            pthread_cond_wait(&background_cond, &background_mutex);
+        }
+        job = background_head;
+        background_head = job->next;
+        if (!background_head){
+            background_tail = NULL;
+        }
+        pthread_mutex_unlock(&background_mutex);
+
+        /* Jobs without a connection may free themselves in run */
+        ms_conn_t *conn = job->conn;
+        job->run(job);
+        if (conn){
+            reactor_complete(job);
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            The loop of a single compute worker. Runs jobs from
+ *                  its own deque, then stolen jobs, and sleeps when no
+ *                  jobs are pending anywhere.
+ * param worker:    The worker to run.
+***********************************************************************/
+void worker_loop(ms_worker_t *worker){
+
+    ms_job_t *job;
+
+    worker_self = worker;
+
+    while (true){
+        job = worker_pop(worker);
+        if (!job){
+            job = worker_steal(worker);
+        }
+
+        if (!job){
+            pthread_mutex_lock(&idle_mutex);
+            while (__atomic_load_n(&jobs_pending, __ATOMIC_SEQ_CST) <= 0){
+                pthread_cond_wait(&idle_cond, &idle_mutex);
+            }
+            pthread_mutex_unlock(&idle_mutex);
+            continue;
+        }
+
+        __atomic_fetch_sub(&jobs_pending, 1, __ATOMIC_SEQ_CST);
+
+        /* Jobs without a connection may free themselves in run */
+        ms_conn_t *conn = job->conn;
+        job->run(job);
+        if (conn){
+            reactor_complete(job);
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Pushes a job onto the bottom of a workers deque,
+ *                  doubling the deque if it is full.
+ * param worker:    The worker to give the job to.
+ * param job:       The job to push.
+***********************************************************************/
+void worker_push(ms_worker_t *worker, ms_job_t *job){
+
+    size_t i;
+
+    pthread_mutex_lock(&worker->mutex);
+
+    if (worker->bottom - worker->top == worker->size){
+        ms_job_t **jobs = malloc(worker->size*2*sizeof(ms_job_t*));
+        if (!jobs){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+        for (i=worker->top;i!=worker->bottom;i++){
+            jobs[i & (worker->size*2-1)] = worker->jobs[i & (worker->size-1)];
+        }
+        free(worker->jobs);
+        worker->jobs = jobs;
+        worker->size *= 2;
+    }
+
+    worker->jobs[worker->bottom & (worker->size-1)] = job;
+    worker->bottom++;
+
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+/***********************************************************************
+ * func:            Pops the newest job from the bottom of a workers
+ *                  own deque. Returns NULL if it is empty.
+ * param worker:    The worker to pop from.
+***********************************************************************/
+ms_job_t* worker_pop(ms_worker_t *worker){
+
+    ms_job_t *job = NULL;
+
+    pthread_mutex_lock(&worker->mutex);
+
+    if (worker->bottom != worker->top){
+        worker->bottom--;
+        job = worker->jobs[worker->bottom & (worker->size-1)];
+    }
+
+    pthread_mutex_unlock(&worker->mutex);
+
+    return job;
+}
+
+/***********************************************************************
+ * func:            Steals the oldest job from the top of another
+ *                  workers deque, trying each in turn from the next
+ *                  worker along. Returns NULL if all are empty.
+ * param worker:    The worker stealing.
+***********************************************************************/
+ms_job_t* worker_steal(ms_worker_t *worker){
+
+    int i;
+    int self = worker - workers;
+    ms_job_t *job = NULL;
+    ms_worker_t *victim;
+
+    for (i=1;i<workers_num && !job;i++){
+        victim = &workers[(self+i) % workers_num];
+
+        pthread_mutex_lock(&victim->mutex);
+
+        if (victim->bottom != victim->top){
+            job = victim->jobs[victim->top & (victim->size-1)];
+            victim->top++;
+        }
+
+        pthread_mutex_unlock(&victim->mutex);
+    }
+
+    return job;
+}
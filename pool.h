@@ -0,0 +1,73 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+/* Reactor definitions */
+#include "reactor.h"
+
+/* Initial number of jobs each worker deque can hold */
+#define POOL_DEQUE_SIZE 64
+
+/* Niceness of the background workers, so the scheduler runs the
+ * reactors and compute workers ahead of them */
+#define POOL_BACKGROUND_NICE 10
+
+/* A struct representing a unit of CPU heavy work. Callers embed it as
+ * the first member of a struct holding the inputs and results */
+typedef struct ms_job ms_job_t;
+typedef void (*job_func_t)(ms_job_t *job);
+struct ms_job{
+    job_func_t run;             /* Called on a pool worker */
+    job_func_t done;            /* Called afterwards on the reactor of conn */
+    ms_conn_t *conn;            /* Connection the job was made for, if any */
+    ms_job_t *next;             /* Next job waiting to be completed */
+};
+
+/***********************************************************************
+ * func:            Starts a given number of compute workers, and as
+ *                  many background workers. Each compute worker takes
+ *                  jobs from the back of its own deque, and when that
+ *                  is empty steals from the front of the others, so a
+ *                  burst of jobs submitted to one worker is spread
+ *                  across all of them.
+ * param count:     The number of workers of each kind to start.
+***********************************************************************/
+void pool_start(int count);
+
+/***********************************************************************
+ * func:            Hands a job to the pool. A job submitted by a
+ *                  worker goes on that workers own deque, otherwise
+ *                  the deques are chosen in turn. If the job has a
+ *                  connection, it must be submitted from the reactor
+ *                  of that connection. The connection is then kept
+ *                  open, and done is called on its reactor, once the
+ *                  job has run. Jobs without a connection must release
+ *                  themselves in run.
+ * param job:       The job to run.
+***********************************************************************/
+void pool_submit(ms_job_t *job);
+
+/***********************************************************************
+ * func:            Returns the number of workers started.
+***********************************************************************/
+int pool_count();
+
+/***********************************************************************
+ * func:            Hands a long running job to the background workers,
+ *                  which take jobs in the order they were submitted.
+ *                  They run at a lower priority and never take compute
+ *                  jobs, so a job that keeps them busy for seconds does
+ *                  not hold up the jobs of other sessions. Connections
+ *                  are handled as in pool_submit.
+ * param job:       The job to run.
+***********************************************************************/
+void pool_submit_background(ms_job_t *job);
+
+/***********************************************************************
+ * func:            Returns the number of background workers started.
+***********************************************************************/
+int pool_background_count();
+
+#endif /* POOL_H_ */
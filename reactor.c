@@ -0,0 +1,809 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/* Compute pool definitions */
+#include "pool.h"
+/* Reactor definitions */
+#include "reactor.h"
+/* io_uring definitions */
+#include "uring.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Operations tagged in the low bits of io_uring user data. Connections
+ * are allocated with malloc, so their low bits are always clear */
+#define URING_OP_MASK 7
+#define URING_RECV 1
+#define URING_SEND 2
+#define URING_WAKE 3
+#define URING_TICK 4
+
+/* The running reactors */
+ms_reactor_t *reactors = NULL;
+int reactors_num = 0;
+backend_t reactors_backend = epoll_backend;
+
+/* Reactor that will be given the next connection */
+unsigned int reactor_next = 0;
+
+/* Handlers for connection input and closing */
+conn_handler_t input_handler = NULL;
+conn_handler_t close_handler = NULL;
+
+/* Ring used to accept connections with io_uring, and the address each
+ * queued accept is written to */
+ms_uring_t accept_ring;
+struct sockaddr_in accept_addrs[URING_ACCEPTS];
+socklen_t accept_addr_lens[URING_ACCEPTS];
+bool accept_queued = false;
+
+/* Function definitions */
+bool reactor_uring_init(ms_reactor_t *reactor);
+void conn_flush(ms_conn_t *conn);
+void conn_settle(ms_conn_t *conn);
+void conn_timed_link(ms_conn_t *conn);
+void conn_timed_unlink(ms_conn_t *conn);
+void conn_free(ms_conn_t *conn);
+void conn_read(ms_conn_t *conn);
+void conn_watch(ms_conn_t *conn, unsigned int events);
+void reactor_adopt(ms_reactor_t *reactor);
+void reactor_complete_jobs(ms_reactor_t *reactor);
+void reactor_expire(ms_reactor_t *reactor);
+void reactor_loop(ms_reactor_t *reactor);
+void reactor_uring_loop(ms_reactor_t *reactor);
+void uring_queue_accept(int listen_fd, int slot);
+void uring_tick_read(ms_reactor_t *reactor);
+void uring_update(ms_conn_t *conn);
+void uring_wake_read(ms_reactor_t *reactor);
+
+int reactor_count(){
+    return reactors_num;
+}
+
+backend_t reactor_start(int count, backend_t backend, conn_handler_t on_input, conn_handler_t on_close){
+    int i, j;
+
+    input_handler = on_input;
+    close_handler = on_close;
+
+    reactors = calloc(count, sizeof(ms_reactor_t));
+    if (!reactors){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Fall back to epoll if any io_uring instance cannot be set up */
+    if (backend == uring_backend){
+        for (i=0;i<count;i++){
+            if (!reactor_uring_init(&reactors[i])){
+                perror("Starting io_uring reactor, using epoll instead");
+                for (j=0;j<i;j++){
+                    uring_exit(&reactors[j].ring);
+                }
+                backend = epoll_backend;
+                break;
+            }
+        }
+    }
+
+    if (backend == uring_backend && uring_init(&accept_ring, URING_ACCEPTS*2) == ERROR){
+        perror("Starting io_uring accept ring, using epoll instead");
+        for (i=0;i<count;i++){
+            uring_exit(&reactors[i].ring);
+        }
+        backend = epoll_backend;
+    }
+
+    for (i=0;i<count;i++){
+        reactors[i].id = i;
+        pthread_mutex_init(&reactors[i].handoff_mutex, NULL);
+
+        if ((reactors[i].wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == ERROR){
+            perror("Creating reactor wake up event");
+            exit(EXIT_FAILURE);
+        }
+
+        struct itimerspec tick = {{REACTOR_TICK, 0}, {REACTOR_TICK, 0}};
+        if ((reactors[i].tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) == ERROR ||
+                timerfd_settime(reactors[i].tick_fd, 0, &tick, NULL) == ERROR){
+            perror("Creating reactor timer");
+            exit(EXIT_FAILURE);
+        }
+
+        if (backend == epoll_backend){
+            if ((reactors[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == ERROR){
+                perror("Creating epoll instance");
+                exit(EXIT_FAILURE);
+            }
+
+            /* Events of the reactor itself carry the address of their
+             * file descriptor instead of a connection */
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &reactors[i].wake_fd;
+            if (epoll_ctl(reactors[i].epoll_fd, EPOLL_CTL_ADD, reactors[i].wake_fd, &event) == ERROR){
+                perror("Adding wake up event to reactor");
+                exit(EXIT_FAILURE);
+            }
+            event.data.ptr = &reactors[i].tick_fd;
+            if (epoll_ctl(reactors[i].epoll_fd, EPOLL_CTL_ADD, reactors[i].tick_fd, &event) == ERROR){
+                perror("Adding timer to reactor");
+                exit(EXIT_FAILURE);
+            }
+            pthread_create(&reactors[i].thread, NULL, (void*) reactor_loop, &reactors[i]);
+        } else {
+            pthread_create(&reactors[i].thread, NULL, (void*) reactor_uring_loop, &reactors[i]);
+        }
+    }
+
+    reactors_num = count;
+    reactors_backend = backend;
+
+    return backend;
+}
+
+int reactor_accept(int listen_fd, struct sockaddr_in *addr){
+
+    socklen_t sin_size = sizeof(struct sockaddr_in);
+    struct io_uring_cqe *cqe;
+    int i, slot, result;
+
+    if (reactors_backend == epoll_backend){
+        return accept(listen_fd, (struct sockaddr *)addr, &sin_size);
+    }
+
+    if (!accept_queued){
+        for (i=0;i<URING_ACCEPTS;i++){
+            uring_queue_accept(listen_fd, i);
+        }
+        accept_queued = true;
+    }
+
+    /* Only enter the kernel once every finished accept has been taken */
+    while ((cqe = uring_peek_cqe(&accept_ring)) == NULL){
+        if (uring_submit(&accept_ring, 1) == ERROR && errno != EINTR){
+            return ERROR;
+        }
+    }
+
+    slot = cqe->user_data;
+    result = cqe->res;
+    uring_cqe_seen(&accept_ring);
+
+    *addr = accept_addrs[slot];
+    uring_queue_accept(listen_fd, slot);
+
+    if (result < 0){
+        errno = -result;
+        return ERROR;
+    }
+
+    return result;
+}
+
+ms_conn_t* reactor_add(int socket_fd, void *data, int timeout){
+
+    ms_conn_t *conn = calloc(1, sizeof(ms_conn_t));
+    if (!conn){
+        perror("System has run out of memory");
+        return NULL;
+    }
+
+    int flags = fcntl(socket_fd, F_GETFL, 0);
+    if (flags == ERROR || fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK) == ERROR){
+        perror("Setting socket non-blocking");
+        free(conn);
+        return NULL;
+    }
+
+    conn->socket_fd = socket_fd;
+    conn->data = data;
+    conn->events = EPOLLIN;
+    conn->deadline = timeout ? time(NULL) + timeout : 0;
+    conn->reactor = &reactors[__atomic_fetch_add(&reactor_next, 1, __ATOMIC_RELAXED) % reactors_num];
+
+    /* The connection is only touched by its own reactor, so pass it over */
+    ms_reactor_t *reactor = conn->reactor;
+    uint64_t value = 1;
+
+    pthread_mutex_lock(&reactor->handoff_mutex);
+    conn->next = reactor->added;
+    reactor->added = conn;
+    pthread_mutex_unlock(&reactor->handoff_mutex);
+
+    if (write(reactor->wake_fd, &value, sizeof(uint64_t)) == ERROR){
+        perror("Waking reactor");
+    }
+
+    return conn;
+}
+
+void conn_close(ms_conn_t *conn){
+    conn->closing = true;
+}
+
+void conn_set_timeout(ms_conn_t *conn, int timeout){
+
+    if (conn->deadline){
+        conn_timed_unlink(conn);
+    }
+
+    conn->deadline = timeout ? time(NULL) + timeout : 0;
+
+    if (conn->deadline){
+        conn_timed_link(conn);
+    }
+}
+
+/***********************************************************************
+ * func:            Adds a connection to the list of connections with a
+ *                  deadline on its reactor.
+ * param conn:      The connection to add.
+***********************************************************************/
+void conn_timed_link(ms_conn_t *conn){
+
+    ms_reactor_t *reactor = conn->reactor;
+
+    conn->timed_prev = NULL;
+    conn->timed_next = reactor->timed;
+    if (reactor->timed){
+        reactor->timed->timed_prev = conn;
+    }
+    reactor->timed = conn;
+}
+
+/***********************************************************************
+ * func:            Removes a connection from the list of connections
+ *                  with a deadline on its reactor.
+ * param conn:      The connection to remove.
+***********************************************************************/
+void conn_timed_unlink(ms_conn_t *conn){
+
+    if (conn->timed_prev){
+        conn->timed_prev->timed_next = conn->timed_next;
+    } else {
+        conn->reactor->timed = conn->timed_next;
+    }
+    if (conn->timed_next){
+        conn->timed_next->timed_prev = conn->timed_prev;
+    }
+}
+
+/***********************************************************************
+ * func:            Starts handling the connections handed to a reactor
+ *                  by reactor_add.
+ * param reactor:   The reactor to adopt connections on.
+***********************************************************************/
+void reactor_adopt(ms_reactor_t *reactor){
+
+    ms_conn_t *conn, *next;
+    struct epoll_event event;
+
+    pthread_mutex_lock(&reactor->handoff_mutex);
+    conn = reactor->added;
+    reactor->added = NULL;
+    pthread_mutex_unlock(&reactor->handoff_mutex);
+
+    for (;conn!=NULL;conn=next){
+        next = conn->next;
+
+        if (conn->deadline){
+            conn_timed_link(conn);
+        }
+
+        if (reactors_backend == uring_backend){
+            uring_update(conn);
+            continue;
+        }
+
+        event.events = conn->events;
+        event.data.ptr = conn;
+
+        if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, conn->socket_fd, &event) == ERROR){
+            perror("Adding connection to reactor");
+            conn->shut = true;
+            conn_free(conn);
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Closes the connections on a reactor whose deadline
+ *                  has passed.
+ * param reactor:   The reactor to check.
+***********************************************************************/
+void reactor_expire(ms_reactor_t *reactor){
+
+    ms_conn_t *conn, *next;
+    time_t now = time(NULL);
+
+    for (conn=reactor->timed;conn!=NULL;conn=next){
+        next = conn->timed_next;
+
+        if (conn->deadline <= now){
+            conn_set_timeout(conn, 0);
+            conn_close(conn);
+            conn_settle(conn);
+        }
+    }
+
+}
+
+void reactor_complete(ms_job_t *job){
+
+    ms_reactor_t *reactor = job->conn->reactor;
+    uint64_t value = 1;
+
+    pthread_mutex_lock(&reactor->handoff_mutex);
+    job->next = reactor->done;
+    reactor->done = job;
+    pthread_mutex_unlock(&reactor->handoff_mutex);
+
+    if (write(reactor->wake_fd, &value, sizeof(uint64_t)) == ERROR){
+        perror("Waking reactor");
+    }
+}
+
+/***********************************************************************
+ * func:            Completes the compute jobs handed back to a reactor,
+ *                  oldest first, and resumes their connections.
+ * param reactor:   The reactor to complete jobs on.
+***********************************************************************/
+void reactor_complete_jobs(ms_reactor_t *reactor){
+
+    ms_job_t *job, *next, *oldest = NULL;
+    ms_conn_t *conn;
+
+    pthread_mutex_lock(&reactor->handoff_mutex);
+    job = reactor->done;
+    reactor->done = NULL;
+    pthread_mutex_unlock(&reactor->handoff_mutex);
+
+    /* The list was built newest first, so reverse it */
+    for (;job!=NULL;job=next){
+        next = job->next;
+        job->next = oldest;
+        oldest = job;
+    }
+
+    for (job=oldest;job!=NULL;job=next){
+        next = job->next;
+        conn = job->conn;
+
+        conn->jobs--;
+        job->done(job);
+
+        if (!conn->closing && conn->in.len > 0){
+            input_handler(conn);
+        }
+        conn_settle(conn);
+    }
+
+}
+
+/***********************************************************************
+ * func:            Sends what output it can on a connection after it
+ *                  has been handled, and frees it once it is closing,
+ *                  its output is gone and no jobs are left to finish.
+ * param conn:      The connection to settle.
+***********************************************************************/
+void conn_settle(ms_conn_t *conn){
+
+    if (reactors_backend == uring_backend){
+        uring_update(conn);
+        return;
+    }
+
+    conn_flush(conn);
+
+    if (conn->closing && conn->out.len == 0){
+        if (conn->jobs == 0){
+            conn_free(conn);
+        } else if (!conn->shut){
+            /* Stop waiting on the socket so a hang up does not spin */
+            epoll_ctl(conn->reactor->epoll_fd, EPOLL_CTL_DEL, conn->socket_fd, NULL);
+            conn->shut = true;
+        }
+    }
+}
+
+/***********************************************************************
+ * func:            The event loop of a single epoll reactor. Waits for
+ *                  connections to become readable or writable, and
+ *                  drives their input, output and closing.
+ * param reactor:   The reactor to run.
+***********************************************************************/
+void reactor_loop(ms_reactor_t *reactor){
+
+    int i, ready;
+    bool woken, ticked;
+    struct epoll_event events[REACTOR_EVENTS];
+    ms_conn_t *conn;
+
+    while (true){
+        ready = epoll_wait(reactor->epoll_fd, events, REACTOR_EVENTS, -1);
+        if (ready == ERROR){
+            if (errno != EINTR){
+                perror("Waiting for events");
+            }
+            continue;
+        }
+
+        woken = false;
+        ticked = false;
+
+        for (i=0;i<ready;i++){
+            conn = events[i].data.ptr;
+
+            if (events[i].data.ptr == &reactor->wake_fd){
+                woken = true;
+                continue;
+            } else if (events[i].data.ptr == &reactor->tick_fd){
+                ticked = true;
+                continue;
+            }
+
+            /* Input is left in the socket while a job is pending, unless
+             * the peer has gone */
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) ||
+                    ((events[i].events & EPOLLIN) && conn->jobs == 0)){
+                conn_read(conn);
+                if (conn->in.len > 0){
+                    input_handler(conn);
+                }
+            }
+
+            conn_settle(conn);
+        }
+
+        /* Handled last, as they may free connections with events above */
+        if (woken){
+            if (read(reactor->wake_fd, &reactor->wake_value, sizeof(uint64_t)) == ERROR && errno != EAGAIN){
+                perror("Reading reactor wake up event");
+            }
+            reactor_adopt(reactor);
+            reactor_complete_jobs(reactor);
+        }
+        if (ticked){
+            if (read(reactor->tick_fd, &reactor->tick_value, sizeof(uint64_t)) == ERROR && errno != EAGAIN){
+                perror("Reading reactor timer");
+            }
+            reactor_expire(reactor);
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Reads all available data on a connection into its
+ *                  input buffer, up to REACTOR_READ_MAX bytes. Marks
+ *                  the connection closing if the peer has gone.
+ * param conn:      The connection to read from.
+***********************************************************************/
+void conn_read(ms_conn_t *conn){
+
+    ssize_t result;
+    size_t total = 0;
+    char *space;
+
+    while (!conn->closing && total < REACTOR_READ_MAX){
+        space = buffer_reserve(&conn->in, 4096);
+        result = recv(conn->socket_fd, space, 4096, PF_UNSPEC);
+        conn->in.len -= 4096 - (result > 0 ? result : 0);
+
+        if (result > 0){
+            total += result;
+        } else if (result == 0){
+            conn->closing = true;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK){
+            break;
+        } else if (errno != EINTR){
+            conn->closing = true;
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Sends as much of a connections pending output as
+ *                  the socket will take, and waits for the socket to
+ *                  become writable if any is left over. The socket is
+ *                  only waited on for input while no job is pending,
+ *                  as requests wait for the job, so a client sending
+ *                  without pause cannot grow the input buffer.
+ * param conn:      The connection to send from.
+***********************************************************************/
+void conn_flush(ms_conn_t *conn){
+
+    unsigned int events = conn->jobs == 0 ? EPOLLIN : 0;
+    ssize_t result;
+
+    while (conn->out_sent < conn->out.len){
+        result = send(conn->socket_fd, conn->out.data + conn->out_sent, conn->out.len - conn->out_sent, MSG_NOSIGNAL);
+        if (result >= 0){
+            conn->out_sent += result;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK){
+            break;
+        } else if (errno != EINTR){
+            /* The peer has gone, so discard what is left */
+            conn->closing = true;
+            conn->out_sent = conn->out.len;
+        }
+    }
+
+    if (conn->out_sent == conn->out.len){
+        conn->out.len = 0;
+        conn->out_sent = 0;
+        conn_watch(conn, events);
+    } else {
+        conn_watch(conn, events | EPOLLOUT);
+    }
+
+}
+
+/***********************************************************************
+ * func:            Changes the events a connection is waiting on, if
+ *                  they differ from those currently waited on.
+ * param conn:      The connection to change.
+ * param events:    The epoll events to wait on.
+***********************************************************************/
+void conn_watch(ms_conn_t *conn, unsigned int events){
+
+    if (conn->events == events || conn->shut){
+        return;
+    }
+
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = conn;
+
+    if (epoll_ctl(conn->reactor->epoll_fd, EPOLL_CTL_MOD, conn->socket_fd, &event) == ERROR){
+        perror("Changing connection events");
+    }
+
+    conn->events = events;
+}
+
+/***********************************************************************
+ * func:            Releases a connection, its session state and its
+ *                  socket.
+ * param conn:      The connection to free.
+***********************************************************************/
+void conn_free(ms_conn_t *conn){
+
+    close_handler(conn);
+
+    if (conn->deadline){
+        conn_timed_unlink(conn);
+    }
+
+    if (reactors_backend == epoll_backend && !conn->shut){
+        epoll_ctl(conn->reactor->epoll_fd, EPOLL_CTL_DEL, conn->socket_fd, NULL);
+    }
+    shutdown(conn->socket_fd, SHUT_RDWR);
+    close(conn->socket_fd);
+
+    buffer_free(&conn->in);
+    buffer_free(&conn->out);
+    buffer_free(&conn->flight);
+    free(conn);
+}
+
+/***********************************************************************
+ * func:            Sets up the io_uring instance and registered receive
+ *                  buffers of a reactor. Returns false if the kernel
+ *                  does not support them.
+ * param reactor:   The reactor to set up.
+***********************************************************************/
+bool reactor_uring_init(ms_reactor_t *reactor){
+
+    if (uring_init(&reactor->ring, URING_ENTRIES) == ERROR){
+        return false;
+    }
+
+    if (uring_bufs_init(&reactor->ring, &reactor->bufs, 0, URING_BUFS, URING_BUF_SIZE) == ERROR){
+        uring_exit(&reactor->ring);
+        return false;
+    }
+
+    return true;
+}
+
+/***********************************************************************
+ * func:            The event loop of a single io_uring reactor. Every
+ *                  receive and send of its connections is queued on
+ *                  its ring, and all queued operations are submitted
+ *                  together each time the reactor waits, so one system
+ *                  call serves many sessions.
+ * param reactor:   The reactor to run.
+***********************************************************************/
+void reactor_uring_loop(ms_reactor_t *reactor){
+
+    struct io_uring_cqe *cqe;
+    ms_conn_t *conn;
+    uint64_t user_data;
+    unsigned int flags;
+    int result;
+    char *data;
+
+    uring_wake_read(reactor);
+    uring_tick_read(reactor);
+
+    while (true){
+        if (uring_submit(&reactor->ring, 1) == ERROR && errno != EINTR && errno != EBUSY && errno != EAGAIN){
+            perror("Submitting to io_uring");
+        }
+
+        while ((cqe = uring_peek_cqe(&reactor->ring)) != NULL){
+            user_data = cqe->user_data;
+            result = cqe->res;
+            flags = cqe->flags;
+            uring_cqe_seen(&reactor->ring);
+
+            conn = (ms_conn_t*)(uintptr_t)(user_data & ~(uint64_t)URING_OP_MASK);
+
+            switch (user_data & URING_OP_MASK){
+                case URING_WAKE:
+                    reactor_adopt(reactor);
+                    reactor_complete_jobs(reactor);
+                    uring_wake_read(reactor);
+                    break;
+                case URING_TICK:
+                    reactor_expire(reactor);
+                    uring_tick_read(reactor);
+                    break;
+                case URING_RECV:
+                    conn->recv_pending = false;
+                    if (result > 0 && (flags & IORING_CQE_F_BUFFER)){
+                        unsigned short bid = flags >> IORING_CQE_BUFFER_SHIFT;
+                        data = uring_bufs_get(&reactor->bufs, bid);
+                        buffer_append(&conn->in, data, result);
+                        uring_bufs_recycle(&reactor->bufs, bid);
+                        input_handler(conn);
+                    } else if (result == 0){
+                        conn->closing = true;
+                    } else if (result != -ENOBUFS && result != -EINTR && result != -EAGAIN){
+                        conn->closing = true;
+                    }
+                    uring_update(conn);
+                    break;
+                case URING_SEND:
+                    conn->send_pending = false;
+                    if (result >= 0){
+                        conn->out_sent += result;
+                    } else if (result != -EINTR && result != -EAGAIN){
+                        /* The peer has gone, so discard what is left */
+                        conn->closing = true;
+                        conn->out_sent = conn->flight.len;
+                        conn->out.len = 0;
+                    }
+                    uring_update(conn);
+                    break;
+            }
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Queues whichever operations a connection needs
+ *                  next: a send of its pending output, a receive of
+ *                  further input while no job is pending, or its
+ *                  release once it is closing and has nothing left in
+ *                  progress.
+ * param conn:      The connection to update.
+***********************************************************************/
+void uring_update(ms_conn_t *conn){
+
+    ms_reactor_t *reactor = conn->reactor;
+    struct io_uring_sqe *sqe;
+
+    /* Output in flight must stay put, so new output builds up in out
+     * and is swapped in once the previous send has finished */
+    if (!conn->send_pending && conn->out_sent == conn->flight.len){
+        conn->flight.len = 0;
+        conn->out_sent = 0;
+        if (conn->out.len > 0){
+            ms_buffer_t swap = conn->flight;
+            conn->flight = conn->out;
+            conn->out = swap;
+        }
+    }
+
+    if (!conn->send_pending && conn->out_sent < conn->flight.len){
+        sqe = uring_get_sqe(&reactor->ring);
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn->socket_fd;
+        sqe->addr = (unsigned long)(conn->flight.data + conn->out_sent);
+        sqe->len = conn->flight.len - conn->out_sent;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = (uintptr_t)conn | URING_SEND;
+        conn->send_pending = true;
+    }
+
+    if (!conn->closing && !conn->recv_pending && conn->jobs == 0){
+        sqe = uring_get_sqe(&reactor->ring);
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = conn->socket_fd;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = reactor->bufs.group;
+        sqe->user_data = (uintptr_t)conn | URING_RECV;
+        conn->recv_pending = true;
+    }
+
+    if (conn->closing && !conn->send_pending && conn->flight.len == 0 && conn->jobs == 0){
+        if (conn->recv_pending){
+            /* Shutting the socket down completes the outstanding receive */
+            if (!conn->shut){
+                shutdown(conn->socket_fd, SHUT_RDWR);
+                conn->shut = true;
+            }
+        } else {
+            conn_free(conn);
+        }
+    }
+
+}
+
+/***********************************************************************
+ * func:            Queues a read of the wake up event of a reactor,
+ *                  which completes when connections are added to it
+ *                  or jobs are handed back to it.
+ * param reactor:   The reactor to wait on.
+***********************************************************************/
+void uring_wake_read(ms_reactor_t *reactor){
+
+    struct io_uring_sqe *sqe = uring_get_sqe(&reactor->ring);
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = reactor->wake_fd;
+    sqe->addr = (unsigned long)&reactor->wake_value;
+    sqe->len = sizeof(uint64_t);
+    sqe->user_data = URING_WAKE;
+}
+
+/***********************************************************************
+ * func:            Queues a read of the timer of a reactor, which
+ *                  completes every REACTOR_TICK seconds.
+ * param reactor:   The reactor to wait on.
+***********************************************************************/
+void uring_tick_read(ms_reactor_t *reactor){
+
+    struct io_uring_sqe *sqe = uring_get_sqe(&reactor->ring);
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = reactor->tick_fd;
+    sqe->addr = (unsigned long)&reactor->tick_value;
+    sqe->len = sizeof(uint64_t);
+    sqe->user_data = URING_TICK;
+}
+
+/***********************************************************************
+ * func:            Queues an accept on the io_uring accept ring.
+ * param listen_fd: The listening socket.
+ * param slot:      The slot the accepted address is written to.
+***********************************************************************/
+void uring_queue_accept(int listen_fd, int slot){
+
+    struct io_uring_sqe *sqe = uring_get_sqe(&accept_ring);
+
+    accept_addr_lens[slot] = sizeof(struct sockaddr_in);
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->addr = (unsigned long)&accept_addrs[slot];
+    sqe->addr2 = (unsigned long)&accept_addr_lens[slot];
+    sqe->user_data = slot;
+}
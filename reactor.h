@@ -0,0 +1,157 @@
+#ifndef REACTOR_H_
+#define REACTOR_H_
+
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* io_uring definitions */
+#include "uring.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Most bytes read from a connection before its input is handled */
+#define REACTOR_READ_MAX 65536
+
+/* Most readiness events handled per wait */
+#define REACTOR_EVENTS 256
+
+/* Seconds between checks for connections that have timed out */
+#define REACTOR_TICK 1
+
+/* Submission queue entries of each io_uring reactor */
+#define URING_ENTRIES 4096
+
+/* Registered receive buffers of each io_uring reactor */
+#define URING_BUFS 1024
+#define URING_BUF_SIZE 4096
+
+/* Accepts kept queued on the io_uring accept ring */
+#define URING_ACCEPTS 16
+
+/* Enums for the I/O backend used by the reactors */
+typedef enum{
+    epoll_backend,
+    uring_backend
+} backend_t;
+
+typedef struct ms_reactor ms_reactor_t;
+
+/* Compute jobs, defined in pool.h */
+struct ms_job;
+
+/* A struct representing a non-blocking client connection. A connection
+ * is only ever touched by the reactor thread that owns it */
+typedef struct ms_conn ms_conn_t;
+struct ms_conn{
+    int socket_fd;
+    ms_buffer_t in;             /* Data recieved but not yet handled */
+    ms_buffer_t out;            /* Data waiting to be sent */
+    ms_buffer_t flight;         /* Data being sent by io_uring */
+    size_t out_sent;            /* Bytes of out, or flight, already sent */
+    unsigned int events;        /* Events currently being waited on */
+    bool recv_pending;          /* An io_uring receive is in progress */
+    bool send_pending;          /* An io_uring send is in progress */
+    bool shut;                  /* Stopped waiting on the socket */
+    int jobs;                   /* Compute jobs not yet completed */
+    bool closing;               /* Close once out has been sent */
+    time_t deadline;            /* When the connection times out, or 0 */
+    ms_reactor_t *reactor;
+    ms_conn_t *next;            /* Next connection waiting to be added */
+    ms_conn_t *timed_prev;      /* Neighbours among connections with a deadline */
+    ms_conn_t *timed_next;
+    void *data;                 /* State of the session on the connection */
+};
+
+/* A struct representing a single event loop thread */
+struct ms_reactor{
+    int id;
+    pthread_t thread;
+    int epoll_fd;               /* Used by the epoll backend */
+    ms_uring_t ring;            /* Used by the io_uring backend */
+    ms_uring_bufs_t bufs;
+    int wake_fd;                /* Signalled when work is handed over */
+    uint64_t wake_value;
+    int tick_fd;                /* Timer for checking deadlines */
+    uint64_t tick_value;
+    ms_conn_t *timed;           /* Connections with a deadline */
+    pthread_mutex_t handoff_mutex;
+    ms_conn_t *added;           /* Connections waiting to be added */
+    struct ms_job *done;        /* Jobs waiting to be completed */
+};
+
+/* Function called with a connection whenever new input arrives, or
+ * once when the connection is about to be closed */
+typedef void (*conn_handler_t)(ms_conn_t *conn);
+
+/***********************************************************************
+ * func:            Starts a given number of reactor threads, each with
+ *                  its own epoll or io_uring instance. If io_uring is
+ *                  requested but unsupported, epoll is used instead.
+ *                  Returns the backend in use.
+ * param count:     The number of reactors to start.
+ * param backend:   The I/O backend requested.
+ * param on_input:  The function to handle input on a connection. It
+ *                  should consume what it handles from conn->in and
+ *                  append any replies to conn->out.
+ * param on_close:  The function to release the session state of a
+ *                  connection before it is closed.
+***********************************************************************/
+backend_t reactor_start(int count, backend_t backend, conn_handler_t on_input, conn_handler_t on_close);
+
+/***********************************************************************
+ * func:            Accepts the next connection on a listening socket,
+ *                  using the backend of the reactors. With io_uring,
+ *                  several accepts are kept queued and their results
+ *                  are collected in batches. Returns the socket file
+ *                  descriptor, or ERROR on failure.
+ * param listen_fd: The listening socket.
+ * param addr:      The address of the connecting client.
+***********************************************************************/
+int reactor_accept(int listen_fd, struct sockaddr_in *addr);
+
+/***********************************************************************
+ * func:            Hands a connected socket to one of the reactors,
+ *                  chosen in turn. The socket is made non-blocking.
+ *                  Safe to call from any thread. Returns the
+ *                  connection, or NULL on failure.
+ * param socket_fd: The socket file descriptor of the connection.
+ * param data:      The session state to attach to the connection.
+ * param timeout:   Seconds until the connection is closed unless its
+ *                  timeout is changed with conn_set_timeout, or 0 for
+ *                  no timeout.
+***********************************************************************/
+ms_conn_t* reactor_add(int socket_fd, void *data, int timeout);
+
+/***********************************************************************
+ * func:            Sets a connection to be closed a given number of
+ *                  seconds from now, replacing any earlier timeout.
+ *                  Must be called on the reactor of the connection.
+ * param conn:      The connection to time out.
+ * param timeout:   Seconds until it is closed, or 0 for no timeout.
+***********************************************************************/
+void conn_set_timeout(ms_conn_t *conn, int timeout);
+
+/***********************************************************************
+ * func:            Hands a finished compute job back to the reactor of
+ *                  its connection, which calls its done function and
+ *                  then resumes handling input on the connection. Safe
+ *                  to call from any thread.
+ * param job:       The finished job.
+***********************************************************************/
+void reactor_complete(struct ms_job *job);
+
+/***********************************************************************
+ * func:            Marks a connection to be closed once all of its
+ *                  pending output has been sent.
+ * param conn:      The connection to close.
+***********************************************************************/
+void conn_close(ms_conn_t *conn);
+
+/***********************************************************************
+ * func:            Returns the number of reactors started.
+***********************************************************************/
+int reactor_count();
+
+#endif /* REACTOR_H_ */
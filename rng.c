@@ -0,0 +1,68 @@
+#include <stdint.h>
+
+/* Random number definitions */
+#include "rng.h"
+
+/* Function definitions */
+uint64_t rng_splitmix(uint64_t *value);
+
+void rng_seed(ms_rng_t *rng, uint64_t seed){
+
+    int i;
+
+    /* Spread the seed over the whole state, which is never all zero */
+    for (i=0;i<4;i++){
+        rng->state[i] = rng_splitmix(&seed);
+    }
+}
+
+uint64_t rng_next(ms_rng_t *rng){
+
+    uint64_t *s = rng->state;
+    uint64_t result = s[1]*5;
+    uint64_t t = s[1] << 17;
+
+    result = ((result << 7) | (result >> 57))*9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
+
+uint32_t rng_below(ms_rng_t *rng, uint32_t bound){
+
+    /* Scale 32 random bits up to the bound, redrawing the few values
+     * that would make some results more likely than others */
+    uint64_t product = (rng_next(rng) >> 32)*bound;
+    uint32_t low = (uint32_t)product;
+
+    if (low < bound){
+        uint32_t threshold = -bound % bound;
+        while (low < threshold){
+            product = (rng_next(rng) >> 32)*bound;
+            low = (uint32_t)product;
+        }
+    }
+
+    return product >> 32;
+}
+
+/***********************************************************************
+ * func:            Advances a splitmix64 sequence and returns its next
+ *                  value, used to expand a seed.
+ * param value:     The state of the sequence.
+***********************************************************************/
+uint64_t rng_splitmix(uint64_t *value){
+
+    uint64_t z = (*value += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
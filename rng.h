@@ -0,0 +1,34 @@
+#ifndef RNG_H_
+#define RNG_H_
+
+#include <stdint.h>
+
+/* A struct representing the state of a xoshiro256** generator. Each
+ * thread keeps its own, so no locking is needed */
+typedef struct{
+    uint64_t state[4];
+} ms_rng_t;
+
+/***********************************************************************
+ * func:            Seeds a generator. The same seed always gives the
+ *                  same sequence.
+ * param rng:       The generator to seed.
+ * param seed:      The seed value.
+***********************************************************************/
+void rng_seed(ms_rng_t *rng, uint64_t seed);
+
+/***********************************************************************
+ * func:            Returns the next 64 random bits of a generator.
+ * param rng:       The generator to draw from.
+***********************************************************************/
+uint64_t rng_next(ms_rng_t *rng);
+
+/***********************************************************************
+ * func:            Returns a uniformly distributed value from 0 up to,
+ *                  but not including, a given bound.
+ * param rng:       The generator to draw from.
+ * param bound:     The number of possible values, at least 1.
+***********************************************************************/
+uint32_t rng_below(ms_rng_t *rng, uint32_t bound);
+
+#endif /* RNG_H_ */
@@ -0,0 +1,1300 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Minesweeper definitions */
+#include "ms.h"
+/* Solver definitions */
+#include "solver.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* What the solver knows of each tile, besides whether it is revealed */
+#define SOLVER_BOMB 1               /* Proven to hold a bomb */
+#define SOLVER_QUEUED 2             /* Waiting to have its count checked */
+#define SOLVER_PAIRING 4            /* Waiting to be compared with its neighbours */
+
+/* A struct representing the progress of the solver through a game.
+ * Revealed tiles whose hidden neighbours have changed are queued, so
+ * that each count is only checked again when it could prove more. They
+ * are queued separately to be compared with the counts near them */
+typedef struct{
+    ms_game_t *game;
+    int cols;
+    int rows;
+    uint8_t *known;
+    int bombs;                      /* Bombs proven so far */
+    int *queue;
+    int head;
+    int tail;
+    int *pairs;
+    int pair_head;
+    int pair_tail;
+} ms_solver_t;
+
+/* A struct representing a hidden tile next to a revealed one */
+typedef struct{
+    int tile;
+    int group;                      /* Group of the tile, -1 until grouped */
+    int position;                   /* Place of the tile within its group */
+    int around;                     /* Revealed neighbours */
+    int counts[8];                  /* Their places in the count list */
+    int left[8];                    /* Tiles of each placed after this one */
+} ms_frontier_tile_t;
+
+/* A struct representing a revealed tile next to a hidden one */
+typedef struct{
+    int value;
+    int around;                     /* Hidden neighbours */
+    int tiles[8];                   /* Their places in the tile list */
+    int waiting;                    /* Tiles not yet put in order */
+    int shift;                      /* Bit of the bombs it needs in a state */
+} ms_frontier_count_t;
+
+/* A struct representing the states reached after deciding the first
+ * tiles of a group. A state holds the bombs still needed by the counts
+ * that have tiles on both sides, three bits each, along with the
+ * arrangements reaching it indexed by how many bombs they hold.
+ * Arrangements that leave the same needs are finished in the same ways,
+ * so are merged */
+typedef struct{
+    int count;
+    int capacity;
+    int least;                      /* Bombs held by the first total of each state */
+    int length;                     /* Totals held for each state */
+    uint64_t *keys;
+    double *totals;
+    int *table;                     /* Hash table of states, twice capacity */
+} ms_frontier_layer_t;
+
+/* A struct representing a group of hidden tiles linked by the counts
+ * around them, and the number of arrangements of bombs found for it,
+ * indexed by how many bombs they hold */
+typedef struct{
+    int size;
+    int *tiles;                     /* Places in the tile list, in order */
+    bool exact;                     /* Whether every arrangement was counted */
+    ms_frontier_layer_t *layers;    /* size+1 layers of states */
+    double *arrangements;           /* size+1 totals */
+} ms_frontier_group_t;
+
+/* A struct representing the tiles between the revealed and hidden
+ * parts of a game */
+typedef struct{
+    ms_game_t *game;
+    int tile_count;
+    ms_frontier_tile_t *tiles;
+    int count_count;
+    ms_frontier_count_t *counts;
+    int group_count;
+    ms_frontier_group_t *groups;
+    long steps;                     /* States left to try */
+} ms_frontier_t;
+
+/* Function definitions */
+void solver_bomb(ms_solver_t *solver, int i);
+void solver_push(ms_solver_t *solver, int i);
+void solver_push_around(ms_solver_t *solver, int i);
+void solver_arrange(ms_frontier_t *frontier, ms_frontier_group_t *group);
+void solver_convolve(const double *a, int a_len, const double *b, int b_len, double *out);
+void solver_group(ms_frontier_t *frontier, int *order);
+void solver_layer_init(ms_frontier_layer_t *layer, int least, int length);
+void solver_spread(ms_frontier_t *frontier, ms_frontier_group_t *group, const double *spread, double *chances);
+void solver_weigh(ms_frontier_t *frontier, ms_solver_hint_t *hint, int hidden);
+
+int solver_group_compare(const void *a, const void *b);
+int solver_int_compare(const void *a, const void *b);
+
+bool solver_count(ms_solver_t *solver, req_t *result);
+bool solver_next(ms_frontier_t *frontier, ms_frontier_tile_t *tile, uint64_t key, int placed, uint64_t *next);
+bool solver_pair(ms_solver_t *solver, int i, const int *inner, int inner_count, int inner_left,
+    int o, const int *outer, int outer_count, int outer_left, req_t *result);
+bool solver_pairs(ms_solver_t *solver, req_t *result);
+
+int solver_hidden(ms_solver_t *solver, int i, int *hidden, int *left);
+int solver_find(const int *list, int length, int value);
+int solver_state(ms_frontier_layer_t *layer, uint64_t key, bool add);
+
+req_t solver_reveal(ms_solver_t *solver, int i);
+req_t solver_single(ms_solver_t *solver, int i);
+
+req_t solver_clear(ms_game_t *game, solver_cancel_t cancel, void *arg){
+
+    ms_solver_t solver;
+    req_t result = valid;
+    int i;
+
+    solver.game = game;
+    solver.cols = game->config.cols;
+    solver.rows = game->config.rows;
+    solver.bombs = 0;
+    solver.head = 0;
+    solver.tail = 0;
+    solver.pair_head = 0;
+    solver.pair_tail = 0;
+    solver.known = calloc(game->tiles, sizeof(uint8_t));
+    solver.queue = malloc(game->tiles*sizeof(int));
+    solver.pairs = malloc(game->tiles*sizeof(int));
+    if (!solver.known || !solver.queue || !solver.pairs){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i=0;i<game->tiles;i++){
+        solver_push(&solver, i);
+    }
+
+    /* Counts are checked one at a time while any are queued, and the
+     * slower rules are only tried once none are left */
+    while (result == valid){
+        if (cancel && cancel(arg)){
+            break;
+        }
+
+        if (solver.head != solver.tail){
+            i = solver.queue[solver.head];
+            solver.head = (solver.head+1) % game->tiles;
+            solver.known[i] &= ~SOLVER_QUEUED;
+            result = solver_single(&solver, i);
+        } else if (!solver_pairs(&solver, &result) && !solver_count(&solver, &result)){
+            break;
+        }
+    }
+
+    free(solver.known);
+    free(solver.queue);
+    free(solver.pairs);
+
+    /* The game may have been won before the solver started */
+    return result != lost && game->hidden_safe == 0 ? won : valid;
+}
+
+/***********************************************************************
+ * func:            Checks the count of a single revealed tile. If its
+ *                  bombs are all proven, the rest of its neighbours are
+ *                  safe, and if it has as many hidden neighbours as
+ *                  bombs left, they are all bombs.
+ * param solver:    The solver to check with.
+ * param i:         The index of the tile.
+***********************************************************************/
+req_t solver_single(ms_solver_t *solver, int i){
+
+    int hidden[8];
+    int left, count, j;
+    req_t result = valid;
+
+    count = solver_hidden(solver, i, hidden, &left);
+    if (count == 0){
+        return valid;
+    }
+
+    if (left == 0){
+        for (j=0;j<count && result==valid;j++){
+            result = solver_reveal(solver, hidden[j]);
+        }
+    } else if (left == count){
+        for (j=0;j<count;j++){
+            solver_bomb(solver, hidden[j]);
+        }
+    }
+
+    return result;
+}
+
+/***********************************************************************
+ * func:            Compares the counts of revealed tiles near each
+ *                  other, taking the queued tiles in turn and comparing
+ *                  each with every revealed tile up to two away, both
+ *                  ways round. Only tiles whose hidden neighbours have
+ *                  changed are queued, so counts are only compared
+ *                  again when they could prove more. Returns true as
+ *                  soon as anything was proven, leaving the rest
+ *                  queued.
+ * param solver:    The solver to check with.
+ * param result:    Set to the outcome of any tile revealed.
+***********************************************************************/
+bool solver_pairs(ms_solver_t *solver, req_t *result){
+
+    int first[8], second[8];
+    int first_left, second_left, first_count, second_count;
+    int i, j, x, y, xi, yi;
+
+    while (solver->pair_head != solver->pair_tail){
+        i = solver->pairs[solver->pair_head];
+        solver->pair_head = (solver->pair_head+1) % solver->game->tiles;
+        solver->known[i] &= ~SOLVER_PAIRING;
+
+        first_count = solver_hidden(solver, i, first, &first_left);
+        if (first_count == 0){
+            continue;
+        }
+        x = i % solver->cols;
+        y = i / solver->cols;
+
+        for (yi=y-2;yi<=y+2;yi++){
+            for (xi=x-2;xi<=x+2;xi++){
+                if ((xi==x && yi==y) || !location_valid(solver->game, xi, yi)){
+                    continue;
+                }
+                j = yi*solver->cols + xi;
+                second_count = solver_hidden(solver, j, second, &second_left);
+                if (second_count == 0){
+                    continue;
+                }
+
+                /* The rest of its neighbours are compared later */
+                if (solver_pair(solver, i, first, first_count, first_left, j, second, second_count, second_left, result) ||
+                        solver_pair(solver, j, second, second_count, second_left, i, first, first_count, first_left, result)){
+                    solver_push(solver, i);
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+/***********************************************************************
+ * func:            Compares the counts of two revealed tiles. When
+ *                  every hidden neighbour of the first is also a
+ *                  neighbour of the second, the other tiles around the
+ *                  second hold the difference between their counts, so
+ *                  they are all safe if that is none, and all bombs if
+ *                  it is every one of them. Returns true if anything
+ *                  was proven.
+ * param solver:    The solver to check with.
+ * param i:         The index of the first tile.
+ * param inner:     The hidden neighbours of the first tile.
+ * param inner_count: The number of them.
+ * param inner_left: The bombs among them.
+ * param o:         The index of the second tile.
+ * param outer:     The hidden neighbours of the second tile.
+ * param outer_count: The number of them.
+ * param outer_left: The bombs among them.
+ * param result:    Set to the outcome of any tile revealed.
+***********************************************************************/
+bool solver_pair(ms_solver_t *solver, int i, const int *inner, int inner_count, int inner_left,
+        int o, const int *outer, int outer_count, int outer_left, req_t *result){
+
+    int rest[8];
+    int rest_count = 0, j;
+    int x = i % solver->cols, y = i / solver->cols;
+    int xo = o % solver->cols, yo = o / solver->cols;
+
+    if (outer_count <= inner_count){
+        return false;
+    }
+
+    for (j=0;j<inner_count;j++){
+        if (abs(inner[j] % solver->cols - xo) > 1 || abs(inner[j] / solver->cols - yo) > 1){
+            return false;
+        }
+    }
+
+    for (j=0;j<outer_count;j++){
+        if (abs(outer[j] % solver->cols - x) > 1 || abs(outer[j] / solver->cols - y) > 1){
+            rest[rest_count++] = outer[j];
+        }
+    }
+
+    if (outer_left == inner_left){
+        for (j=0;j<rest_count && *result==valid;j++){
+            *result = solver_reveal(solver, rest[j]);
+        }
+        return true;
+    }
+
+    if (outer_left - inner_left == rest_count){
+        for (j=0;j<rest_count;j++){
+            solver_bomb(solver, rest[j]);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/***********************************************************************
+ * func:            Reveals every hidden tile not proven to be a bomb
+ *                  once all of the bombs are proven. Returns true if
+ *                  anything was revealed.
+ * param solver:    The solver to check with.
+ * param result:    Set to the outcome of the tiles revealed.
+***********************************************************************/
+bool solver_count(ms_solver_t *solver, req_t *result){
+
+    bool proven = false;
+    int i;
+
+    if (solver->bombs != solver->game->config.bombs){
+        return false;
+    }
+
+    for (i=0;i<solver->game->tiles && *result==valid;i++){
+        if (!(solver->known[i] & SOLVER_BOMB) && !location_revealed(solver->game, i % solver->cols, i / solver->cols)){
+            *result = solver_reveal(solver, i);
+            proven = true;
+        }
+    }
+
+    return proven;
+}
+
+/***********************************************************************
+ * func:            Finds the neighbours of a revealed tile that are
+ *                  hidden and not proven to be bombs. Returns how many
+ *                  there are, or 0 if the tile is not revealed.
+ * param solver:    The solver to check with.
+ * param i:         The index of the tile.
+ * param hidden:    Filled with the indices of those neighbours.
+ * param left:      Set to the number of bombs among them.
+***********************************************************************/
+int solver_hidden(ms_solver_t *solver, int i, int *hidden, int *left){
+
+    int x = i % solver->cols;
+    int y = i / solver->cols;
+    int count = 0;
+    int xi, yi, j;
+
+    if (!location_revealed(solver->game, x, y)){
+        return 0;
+    }
+
+    *left = tile_value(solver->game, x, y);
+
+    for (yi=y-1;yi<=y+1;yi++){
+        for (xi=x-1;xi<=x+1;xi++){
+            if (!location_valid(solver->game, xi, yi) || location_revealed(solver->game, xi, yi)){
+                continue;
+            }
+            j = yi*solver->cols + xi;
+            if (solver->known[j] & SOLVER_BOMB){
+                (*left)--;
+            } else {
+                hidden[count++] = j;
+            }
+        }
+    }
+
+    return count;
+}
+
+/***********************************************************************
+ * func:            Reveals a tile proven to be safe, and queues the
+ *                  revealed tiles around every tile it uncovered.
+ * param solver:    The solver to reveal with.
+ * param i:         The index of the tile.
+***********************************************************************/
+req_t solver_reveal(ms_solver_t *solver, int i){
+
+    req_t result;
+    int j;
+
+    /* It may have been uncovered by an earlier reveal */
+    if (location_revealed(solver->game, i % solver->cols, i / solver->cols)){
+        return valid;
+    }
+
+    result = reveal_tile(solver->game, i % solver->cols, i / solver->cols);
+    if (result != valid){
+        return result;
+    }
+
+    for (j=0;j<solver->game->changed_num;j++){
+        solver_push_around(solver, solver->game->changed[j]);
+    }
+
+    return valid;
+}
+
+/***********************************************************************
+ * func:            Notes a tile proven to be a bomb, and queues the
+ *                  revealed tiles around it.
+ * param solver:    The solver to note it with.
+ * param i:         The index of the tile.
+***********************************************************************/
+void solver_bomb(ms_solver_t *solver, int i){
+
+    if (solver->known[i] & SOLVER_BOMB){
+        return;
+    }
+
+    solver->known[i] |= SOLVER_BOMB;
+    solver->bombs++;
+    solver_push_around(solver, i);
+}
+
+/***********************************************************************
+ * func:            Queues a tile and the tiles around it.
+ * param solver:    The solver to queue them with.
+ * param i:         The index of the tile.
+***********************************************************************/
+void solver_push_around(ms_solver_t *solver, int i){
+
+    int x = i % solver->cols;
+    int y = i / solver->cols;
+    int xi, yi;
+
+    for (yi=y-1;yi<=y+1;yi++){
+        for (xi=x-1;xi<=x+1;xi++){
+            if (location_valid(solver->game, xi, yi)){
+                solver_push(solver, yi*solver->cols + xi);
+            }
+        }
+    }
+}
+
+/***********************************************************************
+ * func:            Queues a tile to have its count checked and to be
+ *                  compared with its neighbours, if it is revealed and
+ *                  not already queued for each.
+ * param solver:    The solver to queue it with.
+ * param i:         The index of the tile.
+***********************************************************************/
+void solver_push(ms_solver_t *solver, int i){
+
+    if (!location_revealed(solver->game, i % solver->cols, i / solver->cols)){
+        return;
+    }
+
+    if (!(solver->known[i] & SOLVER_QUEUED)){
+        solver->known[i] |= SOLVER_QUEUED;
+        solver->queue[solver->tail] = i;
+        solver->tail = (solver->tail+1) % solver->game->tiles;
+    }
+
+    if (!(solver->known[i] & SOLVER_PAIRING)){
+        solver->known[i] |= SOLVER_PAIRING;
+        solver->pairs[solver->pair_tail] = i;
+        solver->pair_tail = (solver->pair_tail+1) % solver->game->tiles;
+    }
+}
+
+void solver_hint(ms_game_t *game, ms_solver_hint_t *hint){
+
+    ms_frontier_t frontier;
+    ms_frontier_tile_t *tile;
+    ms_frontier_count_t *count;
+    uint64_t bits;
+    int *tiles, *order;
+    int found = 0, clear = 0, i, j, w, x, y, xi, yi;
+
+    hint->safe = -1;
+    hint->interior = -1;
+    hint->count = 0;
+    hint->tiles = NULL;
+    hint->chances = NULL;
+
+    /* The first reveal never holds a bomb, so any tile will do. The
+     * bombs then go anywhere but the tiles kept clear around it */
+    if (game->first_turn){
+        x = game->config.cols/2;
+        y = game->config.rows/2;
+        hint->safe = y*game->config.cols + x;
+        for (yi=y-1;yi<=y+1;yi++){
+            for (xi=x-1;xi<=x+1;xi++){
+                clear += location_valid(game, xi, yi);
+            }
+        }
+        if (game->tiles - clear < game->config.bombs){
+            clear = 1;
+        }
+        hint->interior = (double)game->config.bombs / (game->tiles - clear);
+        return;
+    }
+
+    /* Nothing is left to hint at once the game is over */
+    if (game->hidden_safe == 0){
+        return;
+    }
+
+    frontier.game = game;
+    frontier.tile_count = 0;
+    for (w=0;w<game->words;w++){
+        frontier.tile_count += __builtin_popcountll(game->frontier[w]);
+    }
+
+    /* The frontier is listed in order of index, along with the revealed
+     * tiles next to each, at most eight of them */
+    tiles = malloc((frontier.tile_count+1)*sizeof(int));
+    order = malloc((frontier.tile_count*8+1)*sizeof(int));
+    frontier.tiles = malloc((frontier.tile_count+1)*sizeof(ms_frontier_tile_t));
+    frontier.counts = malloc((frontier.tile_count*8+1)*sizeof(ms_frontier_count_t));
+    if (!tiles || !order || !frontier.tiles || !frontier.counts){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    for (w=0,i=0;w<game->words;w++){
+        for (bits=game->frontier[w];bits;bits&=bits-1){
+            tiles[i] = w*64 + __builtin_ctzll(bits);
+            frontier.tiles[i].tile = tiles[i];
+            frontier.tiles[i].group = -1;
+            frontier.tiles[i].around = 0;
+
+            x = tiles[i] % game->config.cols;
+            y = tiles[i] / game->config.cols;
+            for (yi=y-1;yi<=y+1;yi++){
+                for (xi=x-1;xi<=x+1;xi++){
+                    if (location_valid(game, xi, yi) && location_revealed(game, xi, yi)){
+                        order[found++] = yi*game->config.cols + xi;
+                    }
+                }
+            }
+            i++;
+        }
+    }
+
+    qsort(order, found, sizeof(int), solver_int_compare);
+    frontier.count_count = 0;
+    for (i=0;i<found;i++){
+        if (i > 0 && order[i] == order[i-1]){
+            continue;
+        }
+
+        count = &frontier.counts[frontier.count_count];
+        x = order[i] % game->config.cols;
+        y = order[i] / game->config.cols;
+        count->value = tile_value(game, x, y);
+        count->around = 0;
+
+        /* Every hidden neighbour of a revealed tile is on the frontier */
+        for (yi=y-1;yi<=y+1;yi++){
+            for (xi=x-1;xi<=x+1;xi++){
+                if (location_valid(game, xi, yi) && !location_revealed(game, xi, yi)){
+                    j = solver_find(tiles, frontier.tile_count, yi*game->config.cols + xi);
+                    tile = &frontier.tiles[j];
+                    count->tiles[count->around++] = j;
+                    tile->counts[tile->around++] = frontier.count_count;
+                }
+            }
+        }
+        frontier.count_count++;
+    }
+
+    solver_group(&frontier, order);
+    solver_weigh(&frontier, hint, game->hidden_safe + game->config.bombs);
+
+    /* With no bombs left off the frontier, any other hidden tile is safe */
+    if (hint->safe == -1 && hint->interior == 0){
+        for (w=0;w<game->words;w++){
+            bits = ~(game->revealed[w] | game->frontier[w]);
+            if (w == game->words-1){
+                bits &= LAST_WORD_MASK(game);
+            }
+            if (bits){
+                hint->safe = w*64 + __builtin_ctzll(bits);
+                break;
+            }
+        }
+    }
+
+    for (i=0;i<frontier.group_count;i++){
+        for (j=0;frontier.groups[i].layers && j<=frontier.groups[i].size;j++){
+            free(frontier.groups[i].layers[j].keys);
+            free(frontier.groups[i].layers[j].totals);
+            free(frontier.groups[i].layers[j].table);
+        }
+        free(frontier.groups[i].layers);
+        free(frontier.groups[i].arrangements);
+    }
+    free(frontier.groups);
+    free(frontier.tiles);
+    free(frontier.counts);
+    free(tiles);
+    free(order);
+}
+
+void solver_hint_free(ms_solver_hint_t *hint){
+    free(hint->tiles);
+    free(hint->chances);
+}
+
+/***********************************************************************
+ * func:            Splits the frontier into groups of tiles linked by
+ *                  the counts around them, and counts the arrangements
+ *                  of bombs in each, smallest group first so that one
+ *                  large group cannot use up the steps of the rest.
+ * param frontier:  The frontier to split.
+ * param order:     Space for the tile list, to be ordered by group.
+***********************************************************************/
+void solver_group(ms_frontier_t *frontier, int *order){
+
+    ms_frontier_group_t *group;
+    ms_frontier_tile_t *tile, *next;
+    ms_frontier_count_t *count;
+    unsigned spare;
+    int *sorted, *near;
+    int head, tail = 0, near_count, first, best, fewest, score, nearest, i, j, k;
+
+    frontier->group_count = 0;
+    frontier->groups = malloc((frontier->tile_count+1)*sizeof(ms_frontier_group_t));
+    if (!frontier->groups){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Each group is a breadth first search from its first tile */
+    for (i=0;i<frontier->tile_count;i++){
+        if (frontier->tiles[i].group != -1){
+            continue;
+        }
+
+        group = &frontier->groups[frontier->group_count];
+        group->tiles = &order[tail];
+        group->size = 0;
+
+        frontier->tiles[i].group = frontier->group_count;
+        order[tail++] = i;
+
+        for (head=group->tiles-order;head<tail;head++){
+            tile = &frontier->tiles[order[head]];
+            tile->position = -1;
+            group->size++;
+
+            for (j=0;j<tile->around;j++){
+                count = &frontier->counts[tile->counts[j]];
+                for (k=0;k<count->around;k++){
+                    next = &frontier->tiles[count->tiles[k]];
+                    if (next->group == -1){
+                        next->group = frontier->group_count;
+                        order[tail++] = next - frontier->tiles;
+                    }
+                }
+            }
+        }
+
+        group->exact = true;
+        group->layers = NULL;
+        group->arrangements = NULL;
+        frontier->group_count++;
+    }
+
+    for (i=0;i<frontier->count_count;i++){
+        frontier->counts[i].shift = -1;
+        frontier->counts[i].waiting = frontier->counts[i].around;
+    }
+
+    sorted = malloc((frontier->tile_count+1)*sizeof(int));
+    near = malloc((frontier->tile_count+1)*sizeof(int));
+    if (!sorted || !near){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Each count holds three bits of the state from its first tile to
+     * its last, which are free again once it is met. The tiles are put
+     * in order so that few counts are open at once, each taken from
+     * those next to an open count, opening as few more counts as it
+     * meets, and nearest to meeting a count */
+    for (i=0;i<frontier->group_count;i++){
+        group = &frontier->groups[i];
+        spare = (1U << SOLVER_OPEN_MAX) - 1;
+        near_count = 0;
+        first = 0;
+        for (head=0;head<group->size && group->exact;head++){
+            if (near_count == 0){
+                while (frontier->tiles[group->tiles[first]].position != -1){
+                    first++;
+                }
+                tile = &frontier->tiles[group->tiles[first]];
+            } else {
+                best = 0;
+                fewest = INT_MAX;
+                for (j=0;j<near_count;j++){
+                    tile = &frontier->tiles[near[j]];
+                    score = 0;
+                    nearest = 8;
+                    for (k=0;k<tile->around;k++){
+                        count = &frontier->counts[tile->counts[k]];
+                        score += (count->shift == -1) - (count->waiting == 1);
+                        if (count->shift != -1 && count->waiting < nearest){
+                            nearest = count->waiting;
+                        }
+                    }
+                    score = score*10 + nearest;
+                    if (score < fewest){
+                        fewest = score;
+                        best = j;
+                    }
+                }
+                tile = &frontier->tiles[near[best]];
+                near[best] = near[--near_count];
+            }
+
+            sorted[head] = tile - frontier->tiles;
+            tile->position = head;
+            for (j=0;j<tile->around;j++){
+                count = &frontier->counts[tile->counts[j]];
+                if (count->shift == -1){
+                    if (!spare){
+                        group->exact = false;
+                        break;
+                    }
+                    count->shift = 3*__builtin_ctz(spare);
+                    spare &= spare-1;
+
+                    for (k=0;k<count->around;k++){
+                        next = &frontier->tiles[count->tiles[k]];
+                        if (next->position == -1){
+                            next->position = -2;
+                            near[near_count++] = next - frontier->tiles;
+                        }
+                    }
+                }
+                tile->left[j] = --count->waiting;
+            }
+            for (j=0;j<tile->around && group->exact;j++){
+                count = &frontier->counts[tile->counts[j]];
+                if (count->waiting == 0){
+                    spare |= 1U << count->shift/3;
+                }
+            }
+        }
+
+        for (j=0;j<group->size && group->exact;j++){
+            group->tiles[j] = sorted[j];
+        }
+    }
+
+    free(sorted);
+    free(near);
+
+    qsort(frontier->groups, frontier->group_count, sizeof(ms_frontier_group_t), solver_group_compare);
+
+    frontier->steps = SOLVER_HINT_STEPS;
+    for (i=0;i<frontier->group_count;i++){
+        if (frontier->groups[i].exact){
+            solver_arrange(frontier, &frontier->groups[i]);
+        }
+    }
+}
+
+/***********************************************************************
+ * func:            Counts the arrangements of bombs in a group, deciding
+ *                  its tiles in order and keeping a layer of states
+ *                  after each. An arrangement is dropped as soon as a
+ *                  count around the tile decided can no longer be met.
+ *                  Marks the group as not exact if the steps run out.
+ * param frontier:  The frontier holding the group.
+ * param group:     The group to count.
+***********************************************************************/
+void solver_arrange(ms_frontier_t *frontier, ms_frontier_group_t *group){
+
+    ms_frontier_layer_t *from, *to;
+    ms_frontier_tile_t *tile;
+    uint64_t next;
+    double largest, value;
+    int position, placed, state, target, least, most, k;
+
+    group->layers = calloc(group->size+1, sizeof(ms_frontier_layer_t));
+    group->arrangements = calloc(group->size+1, sizeof(double));
+    if (!group->layers || !group->arrangements){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    solver_layer_init(&group->layers[0], 0, 1);
+    group->layers[0].totals[solver_state(&group->layers[0], 0, true)] = 1;
+
+    for (position=0;position<group->size;position++){
+        tile = &frontier->tiles[group->tiles[position]];
+        from = &group->layers[position];
+        to = &group->layers[position+1];
+        solver_layer_init(to, from->least, from->length+1);
+
+        for (state=0;state<from->count;state++){
+            for (placed=0;placed<2;placed++){
+                if (--frontier->steps < 0){
+                    group->exact = false;
+                    return;
+                }
+                if (!solver_next(frontier, tile, from->keys[state], placed, &next)){
+                    continue;
+                }
+
+                target = solver_state(to, next, true);
+                for (k=0;k<from->length;k++){
+                    to->totals[target*to->length + k + placed] += from->totals[state*from->length + k];
+                }
+            }
+        }
+
+        /* The layer is trimmed to the bombs its states hold, and as only
+         * the ratios between its totals matter, kept in range */
+        largest = 0;
+        least = to->length;
+        most = -1;
+        for (k=0;k<to->count*to->length;k++){
+            if (to->totals[k] > 0){
+                largest = to->totals[k] > largest ? to->totals[k] : largest;
+                least = k % to->length < least ? k % to->length : least;
+                most = k % to->length > most ? k % to->length : most;
+            }
+        }
+        if (most == -1){
+            continue;
+        }
+        for (state=0;state<to->count;state++){
+            for (k=least;k<=most;k++){
+                value = to->totals[state*to->length + k];
+                to->totals[state*(most-least+1) + k-least] = largest > 1e200 ? value / largest : value;
+            }
+        }
+        to->least += least;
+        to->length = most-least+1;
+    }
+
+    /* Every count is met in the last layer, leaving a single state */
+    to = &group->layers[group->size];
+    if (to->count == 1){
+        for (k=0;k<to->length;k++){
+            group->arrangements[to->least + k] = to->totals[k];
+        }
+    } else {
+        group->exact = false;
+    }
+}
+
+/***********************************************************************
+ * func:            Weighs the arrangements of every exact group
+ *                  together. Each total of bombs on the groups is
+ *                  weighted by the ways of placing the remaining bombs
+ *                  on the other hidden tiles, giving the chance of a
+ *                  bomb on each tile. Tiles of groups that are not
+ *                  exact count as other hidden tiles.
+ * param frontier:  The frontier to weigh.
+ * param hint:      Filled with the chances and a safe tile, if any.
+ * param hidden:    The number of hidden tiles.
+***********************************************************************/
+void solver_weigh(ms_frontier_t *frontier, ms_solver_hint_t *hint, int hidden){
+
+    ms_frontier_group_t *group;
+    double **before, **after, *weights, *others, *spread, total, largest, chance, interior;
+    int *before_len, *after_len;
+    int sizes = 0, widest = 0, other, bombs = frontier->game->config.bombs, length, least, most, i, j, k;
+
+    for (i=0;i<frontier->group_count;i++){
+        if (frontier->groups[i].exact){
+            sizes += frontier->groups[i].size;
+            widest = frontier->groups[i].size > widest ? frontier->groups[i].size : widest;
+        }
+    }
+    other = hidden - sizes;
+
+    before = malloc((frontier->group_count+1)*sizeof(double*));
+    after = malloc((frontier->group_count+1)*sizeof(double*));
+    before_len = malloc((frontier->group_count+1)*sizeof(int));
+    after_len = malloc((frontier->group_count+1)*sizeof(int));
+    weights = calloc(sizes+1, sizeof(double));
+    others = malloc((sizes+1)*sizeof(double));
+    spread = malloc((widest+1)*sizeof(double));
+    hint->tiles = malloc((frontier->tile_count+1)*sizeof(int));
+    hint->chances = malloc((frontier->tile_count+1)*sizeof(double));
+    if (!before || !after || !before_len || !after_len || !weights || !others || !spread || !hint->tiles || !hint->chances){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Only the ratios between totals matter, so each group is scaled
+     * to keep the products in range */
+    for (i=0;i<frontier->group_count;i++){
+        group = &frontier->groups[i];
+        if (!group->exact){
+            continue;
+        }
+        largest = 0;
+        for (k=0;k<=group->size;k++){
+            largest = group->arrangements[k] > largest ? group->arrangements[k] : largest;
+        }
+        for (k=0;k<=group->size && largest>0;k++){
+            group->arrangements[k] /= largest;
+        }
+    }
+
+    /* The totals over the groups before and after each one */
+    before[0] = calloc(1, sizeof(double));
+    after[frontier->group_count] = calloc(1, sizeof(double));
+    if (!before[0] || !after[frontier->group_count]){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+    before[0][0] = 1;
+    after[frontier->group_count][0] = 1;
+    before_len[0] = 1;
+    after_len[frontier->group_count] = 1;
+    for (i=0,length=1;i<frontier->group_count;i++){
+        group = &frontier->groups[i];
+        before[i+1] = calloc(length + (group->exact ? group->size : 0), sizeof(double));
+        if (!before[i+1]){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+        if (group->exact){
+            solver_convolve(before[i], length, group->arrangements, group->size+1, before[i+1]);
+            length += group->size;
+        } else {
+            for (j=0;j<length;j++){
+                before[i+1][j] = before[i][j];
+            }
+        }
+        before_len[i+1] = length;
+    }
+    for (i=frontier->group_count-1,length=1;i>=0;i--){
+        group = &frontier->groups[i];
+        after[i] = calloc(length + (group->exact ? group->size : 0), sizeof(double));
+        if (!after[i]){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+        if (group->exact){
+            solver_convolve(group->arrangements, group->size+1, after[i+1], length, after[i]);
+            length += group->size;
+        } else {
+            for (j=0;j<length;j++){
+                after[i][j] = after[i+1][j];
+            }
+        }
+        after_len[i] = length;
+    }
+
+    /* Ways of placing the bombs left off the groups on the other tiles,
+     * as ratios from the fewest bombs on the groups that leaves room */
+    least = bombs - other > 0 ? bombs - other : 0;
+    most = bombs < sizes ? bombs : sizes;
+    if (least <= most){
+        weights[least] = 1;
+    }
+    for (k=least+1;k<=most;k++){
+        j = bombs - k + 1;
+        weights[k] = weights[k-1] * j / (other - j + 1);
+        if (weights[k] > 1e200){
+            for (j=least;j<=k;j++){
+                weights[j] /= 1e200;
+            }
+        }
+    }
+
+    total = 0;
+    interior = 0;
+    for (k=0;k<=sizes;k++){
+        total += before[frontier->group_count][k] * weights[k];
+        interior += before[frontier->group_count][k] * weights[k] * (bombs - k);
+    }
+    if (other > 0 && total > 0){
+        hint->interior = interior / total / other;
+    }
+
+    for (i=0;i<frontier->group_count;i++){
+        group = &frontier->groups[i];
+
+        for (j=0;j<group->size;j++){
+            hint->tiles[hint->count] = frontier->tiles[group->tiles[j]].tile;
+            hint->chances[hint->count++] = hint->interior;
+        }
+        if (!group->exact || total <= 0){
+            continue;
+        }
+
+        length = before_len[i] + after_len[i+1] - 1;
+        solver_convolve(before[i], before_len[i], after[i+1], after_len[i+1], others);
+        for (k=0;k<=group->size;k++){
+            spread[k] = 0;
+            for (j=0;j<length;j++){
+                spread[k] += others[j] * weights[k+j];
+            }
+        }
+
+        solver_spread(frontier, group, spread, &hint->chances[hint->count - group->size]);
+
+        for (j=0;j<group->size;j++){
+            chance = hint->chances[hint->count - group->size + j];
+
+            /* A tile with a bomb in no arrangement is proven safe */
+            if (chance == 0 && (hint->safe == -1 || frontier->tiles[group->tiles[j]].tile < hint->safe)){
+                hint->safe = frontier->tiles[group->tiles[j]].tile;
+            }
+        }
+    }
+
+    for (i=0;i<=frontier->group_count;i++){
+        free(before[i]);
+        free(after[i]);
+    }
+    free(before);
+    free(after);
+    free(before_len);
+    free(after_len);
+    free(weights);
+    free(others);
+    free(spread);
+}
+
+/***********************************************************************
+ * func:            Convolves two lists of totals, IE: finds the totals
+ *                  of each sum of an index into each list.
+ * param a:         The first list.
+ * param a_len:     The length of the first list.
+ * param b:         The second list.
+ * param b_len:     The length of the second list.
+ * param out:       Filled with a_len+b_len-1 totals.
+***********************************************************************/
+void solver_convolve(const double *a, int a_len, const double *b, int b_len, double *out){
+
+    int i, j;
+
+    for (i=0;i<a_len+b_len-1;i++){
+        out[i] = 0;
+    }
+    for (i=0;i<a_len;i++){
+        for (j=0;j<b_len;j++){
+            out[i+j] += a[i]*b[j];
+        }
+    }
+}
+
+/***********************************************************************
+ * func:            Orders groups from smallest to largest, for qsort.
+ * param a:         The first group.
+ * param b:         The second group.
+***********************************************************************/
+int solver_group_compare(const void *a, const void *b){
+    return ((ms_frontier_group_t*)a)->size - ((ms_frontier_group_t*)b)->size;
+}
+
+/***********************************************************************
+ * func:            Returns the place of a value in a sorted list that
+ *                  holds it.
+ * param list:      The list to search.
+ * param length:    The length of the list.
+ * param value:     The value to find.
+***********************************************************************/
+int solver_find(const int *list, int length, int value){
+
+    int low = 0, high = length-1, middle;
+
+    while (low < high){
+        middle = (low+high)/2;
+        if (list[middle] < value){
+            low = middle+1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/***********************************************************************
+ * func:            Orders integers from smallest to largest, for qsort.
+ * param a:         The first integer.
+ * param b:         The second integer.
+***********************************************************************/
+int solver_int_compare(const void *a, const void *b){
+    return *(const int*)a - *(const int*)b;
+}
+
+/***********************************************************************
+ * func:            Finds the chance of a bomb on each tile of a group,
+ *                  going back through its layers. Each state is given
+ *                  the weight of every way of finishing an arrangement
+ *                  from it, so the chance of a tile comes from the
+ *                  states on either side of it.
+ * param frontier:  The frontier holding the group.
+ * param group:     The exact group to find the chances of.
+ * param spread:    The weight of each total of bombs on the group.
+ * param chances:   Filled with the chance of each tile, in order.
+***********************************************************************/
+void solver_spread(ms_frontier_t *frontier, ms_frontier_group_t *group, const double *spread, double *chances){
+
+    ms_frontier_layer_t *from, *to;
+    ms_frontier_tile_t *tile;
+    double *ahead, *here, weight, bomb, total, largest;
+    uint64_t next;
+    int position, placed, state, target, k, j;
+
+    to = &group->layers[group->size];
+    ahead = malloc(to->length*sizeof(double));
+    if (!ahead){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+    for (k=0;k<to->length;k++){
+        ahead[k] = spread[to->least + k];
+    }
+
+    for (position=group->size-1;position>=0;position--){
+        tile = &frontier->tiles[group->tiles[position]];
+        from = &group->layers[position];
+        to = &group->layers[position+1];
+
+        here = calloc(from->count*from->length, sizeof(double));
+        if (!here){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+
+        bomb = 0;
+        for (state=0;state<from->count;state++){
+            for (placed=0;placed<2;placed++){
+                if (!solver_next(frontier, tile, from->keys[state], placed, &next)){
+                    continue;
+                }
+                target = solver_state(to, next, false);
+                if (target == -1){
+                    continue;
+                }
+
+                /* Totals trimmed from the layer after were never reached */
+                for (k=0;k<from->length;k++){
+                    j = from->least + k + placed - to->least;
+                    if (j < 0 || j >= to->length){
+                        continue;
+                    }
+                    weight = ahead[target*to->length + j];
+                    here[state*from->length + k] += weight;
+                    if (placed){
+                        bomb += from->totals[state*from->length + k] * weight;
+                    }
+                }
+            }
+        }
+
+        total = 0;
+        largest = 0;
+        for (k=0;k<from->count*from->length;k++){
+            total += from->totals[k] * here[k];
+            largest = here[k] > largest ? here[k] : largest;
+        }
+        chances[position] = total > 0 ? bomb / total : 0;
+
+        for (k=0;k<from->count*from->length && largest > 1e200;k++){
+            here[k] /= largest;
+        }
+
+        free(ahead);
+        ahead = here;
+    }
+
+    free(ahead);
+}
+
+/***********************************************************************
+ * func:            Decides a single tile of a group in a state, giving
+ *                  the state after it. Returns false if a count around
+ *                  the tile could no longer be met.
+ * param frontier:  The frontier holding the tile.
+ * param tile:      The tile to decide.
+ * param key:       The state before the tile.
+ * param placed:    1 if a bomb is placed on the tile, otherwise 0.
+ * param next:      Filled with the state after the tile.
+***********************************************************************/
+bool solver_next(ms_frontier_t *frontier, ms_frontier_tile_t *tile, uint64_t key, int placed, uint64_t *next){
+
+    ms_frontier_count_t *count;
+    int need, j;
+
+    for (j=0;j<tile->around;j++){
+        count = &frontier->counts[tile->counts[j]];
+
+        /* A count opened by the tile needs its whole value, and one met
+         * by it needs nothing more, leaving its bits clear for another */
+        need = tile->left[j] == count->around-1 ? count->value : (int)((key >> count->shift) & 7);
+        need -= placed;
+        if (need < 0 || need > tile->left[j]){
+            return false;
+        }
+        key = (key & ~(7ULL << count->shift)) | (uint64_t)need << count->shift;
+    }
+
+    *next = key;
+    return true;
+}
+
+/***********************************************************************
+ * func:            Allocates an empty layer of states.
+ * param layer:     The layer to set up.
+ * param least:     The bombs held by the first total of each state.
+ * param length:    The totals held for each state.
+***********************************************************************/
+void solver_layer_init(ms_frontier_layer_t *layer, int least, int length){
+
+    int i;
+
+    layer->count = 0;
+    layer->capacity = 4;
+    layer->least = least;
+    layer->length = length;
+    layer->keys = malloc(layer->capacity*sizeof(uint64_t));
+    layer->totals = calloc(layer->capacity*length, sizeof(double));
+    layer->table = malloc(layer->capacity*2*sizeof(int));
+    if (!layer->keys || !layer->totals || !layer->table){
+        perror("System has run out of memory");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i=0;i<layer->capacity*2;i++){
+        layer->table[i] = -1;
+    }
+}
+
+/***********************************************************************
+ * func:            Returns the place of a state in a layer, or -1 if it
+ *                  is not there and is not to be added. Added states
+ *                  start with no arrangements.
+ * param layer:     The layer to search.
+ * param key:       The state to find.
+ * param add:       Whether to add the state if it is not there.
+***********************************************************************/
+int solver_state(ms_frontier_layer_t *layer, uint64_t key, bool add){
+
+    int mask = layer->capacity*2 - 1, slot, count, i;
+
+    slot = ((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (layer->table[slot] != -1){
+        if (layer->keys[layer->table[slot]] == key){
+            return layer->table[slot];
+        }
+        slot = (slot+1) & mask;
+    }
+
+    if (!add){
+        return -1;
+    }
+
+    /* The table is kept at most half full, growing with the states */
+    if (layer->count == layer->capacity){
+        layer->capacity *= 2;
+        layer->keys = realloc(layer->keys, layer->capacity*sizeof(uint64_t));
+        layer->totals = realloc(layer->totals, layer->capacity*layer->length*sizeof(double));
+        free(layer->table);
+        layer->table = malloc(layer->capacity*2*sizeof(int));
+        if (!layer->keys || !layer->totals || !layer->table){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+
+        for (i=layer->count*layer->length;i<layer->capacity*layer->length;i++){
+            layer->totals[i] = 0;
+        }
+        for (i=0;i<layer->capacity*2;i++){
+            layer->table[i] = -1;
+        }
+
+        count = layer->count;
+        layer->count = 0;
+        for (i=0;i<count;i++){
+            solver_state(layer, layer->keys[i], true);
+        }
+
+        return solver_state(layer, key, add);
+    }
+
+    layer->keys[layer->count] = key;
+    layer->table[slot] = layer->count;
+
+    return layer->count++;
+}
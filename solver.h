@@ -0,0 +1,72 @@
+#ifndef SOLVER_H_
+#define SOLVER_H_
+
+#include <stdbool.h>
+
+/* Minesweeper definitions */
+#include "ms.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Most revealed tiles whose counts are open at once while counting the
+ * arrangements of a group, each taking three bits of a 64 bit state, and
+ * the most states tried over a whole hint. Groups beyond either are
+ * treated as if they were not next to revealed tiles */
+#define SOLVER_OPEN_MAX 21
+#define SOLVER_HINT_STEPS (1 << 16)
+
+/* Called by the solver between deductions, returning true to give up */
+typedef bool (*solver_cancel_t)(void *arg);
+
+/* A struct representing a hint for a game. Chances of a bomb are given
+ * for each hidden tile next to a revealed one, and as a single chance
+ * for every other hidden tile */
+typedef struct{
+    int safe;                       /* Index of a tile proven safe, -1 if none is */
+    double interior;                /* Chance for the other hidden tiles, -1 if none */
+    int count;                      /* Hidden tiles next to a revealed one */
+    int *tiles;                     /* Their indices */
+    double *chances;                /* Chance of a bomb on each */
+} ms_solver_hint_t;
+
+/***********************************************************************
+ * func:            Plays a game on from its current state, using only
+ *                  what is shown to the player. Tiles are revealed
+ *                  once they are proven safe and bombs are noted once
+ *                  they are proven, from the count of each revealed
+ *                  tile, from pairs of revealed tiles whose hidden
+ *                  neighbours overlap, and from the number of bombs
+ *                  left. The solver never guesses, so the same game
+ *                  always plays out the same way. Flags are ignored.
+ *                  Returns won if the game was cleared, or valid if
+ *                  it needs a guess or was cancelled.
+ * param game:      The game to play, whose first tile is revealed.
+ * param cancel:    The function checked between deductions, or NULL.
+ * param arg:       The argument passed to cancel.
+***********************************************************************/
+req_t solver_clear(ms_game_t *game, solver_cancel_t cancel, void *arg);
+
+/***********************************************************************
+ * func:            Works out a hint for a game from what is shown to
+ *                  the player. The hidden tiles next to revealed ones
+ *                  are split into groups that share no revealed
+ *                  neighbours, and every arrangement of bombs in each
+ *                  group that fits the counts around it is counted.
+ *                  The groups are then weighed together against the
+ *                  ways of placing the remaining bombs on the other
+ *                  hidden tiles. Flags are ignored, as they may be
+ *                  wrong. The work grows with the number of tiles next
+ *                  to revealed ones, apart from a single pass over the
+ *                  bit planes. The hint is freed with solver_hint_free.
+ * param game:      The game to work out a hint for.
+ * param hint:      Filled with the hint.
+***********************************************************************/
+void solver_hint(ms_game_t *game, ms_solver_hint_t *hint);
+
+/***********************************************************************
+ * func:            Frees the lists of a hint made by solver_hint.
+ * param hint:      The hint to free.
+***********************************************************************/
+void solver_hint_free(ms_solver_hint_t *hint);
+
+#endif /* SOLVER_H_ */
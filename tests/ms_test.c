@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Minesweeper definitions */
+#include "../ms.h"
+/* Utility definitions */
+#include "../utils.h"
+
+/* Number of checks that have failed */
+int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)){ \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+/***********************************************************************
+ * func:            Finds a tile of a given game board, returning its
+ *                  index, or ERROR if there is none.
+ * param game:      The game board to search.
+ * param bomb:      Whether the tile must hold a bomb, or be a blank.
+***********************************************************************/
+int find_tile(ms_game_t *game, bool bomb){
+
+    int i;
+
+    for (i=0;i<game->tiles;i++){
+        if (bomb ? BIT_TEST(game->bombs, i) : !BIT_TEST(game->bombs, i) && game->adjacent[i] == 0){
+            return i;
+        }
+    }
+
+    return ERROR;
+}
+
+/***********************************************************************
+ * func:            Checks that a lost game takes no more moves. Every
+ *                  tile is shown once the game is lost, so a chord on
+ *                  a blank tile has as many flags around it as its
+ *                  value, and must not be taken as a win.
+***********************************************************************/
+void test_moves_after_loss(){
+
+    ms_config_t config = {16, 16, 40, 0};
+    ms_game_t *game = new_game(1, config);
+    int cols = config.cols;
+    int bomb, blank;
+
+    CHECK(reveal_tile(game, 0, 0) != lost);
+    CHECK(!game_over(game));
+
+    bomb = find_tile(game, true);
+    blank = find_tile(game, false);
+    CHECK(bomb != ERROR && blank != ERROR);
+
+    CHECK(reveal_tile(game, bomb % cols, bomb / cols) == lost);
+    CHECK(game_over(game));
+
+    CHECK(chord_tile(game, blank % cols, blank / cols) == invalid);
+    CHECK(reveal_tile(game, blank % cols, blank / cols) == invalid);
+    CHECK(flag_tile(game, bomb % cols, bomb / cols) == invalid);
+    CHECK(game->changed_num == 0);
+
+    free_game(game);
+}
+
+/***********************************************************************
+ * func:            Checks that a won game takes no more moves.
+***********************************************************************/
+void test_moves_after_win(){
+
+    ms_config_t config = {2, 1, 1, 0};
+    ms_game_t *game = new_game(1, config);
+
+    CHECK(reveal_tile(game, 0, 0) == won);
+    CHECK(game_over(game));
+    CHECK(chord_tile(game, 0, 0) == invalid);
+    CHECK(flag_tile(game, 1, 0) == invalid);
+
+    free_game(game);
+}
+
+int main(){
+
+    test_moves_after_loss();
+    test_moves_after_win();
+
+    if (failures){
+        printf("%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("All checks passed\n");
+    return EXIT_SUCCESS;
+}
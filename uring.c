@@ -0,0 +1,207 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* io_uring definitions */
+#include "uring.h"
+/* Utility definitions */
+#include "utils.h"
+
+/* Ordered access to the memory shared with the kernel */
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+int uring_init(ms_uring_t *ring, unsigned entries){
+
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(ms_uring_t));
+    memset(&params, 0, sizeof(struct io_uring_params));
+
+    ring->ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->ring_fd == ERROR){
+        return ERROR;
+    }
+
+    /* Sockets are only handled efficiently with fast poll (Linux 5.7) */
+    if (!(params.features & IORING_FEAT_FAST_POLL)){
+        close(ring->ring_fd);
+        errno = ENOSYS;
+        return ERROR;
+    }
+
+    ring->sq_len = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+    ring->sqes_len = params.sq_entries*sizeof(struct io_uring_sqe);
+
+    /* Newer kernels map both rings with one call */
+    if (params.features & IORING_FEAT_SINGLE_MMAP){
+        if (ring->cq_len > ring->sq_len){
+            ring->sq_len = ring->cq_len;
+        }
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED){
+        close(ring->ring_fd);
+        return ERROR;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP){
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED){
+            munmap(ring->sq_ptr, ring->sq_len);
+            close(ring->ring_fd);
+            return ERROR;
+        }
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED){
+        if (ring->cq_ptr != ring->sq_ptr){
+            munmap(ring->cq_ptr, ring->cq_len);
+        }
+        munmap(ring->sq_ptr, ring->sq_len);
+        close(ring->ring_fd);
+        return ERROR;
+    }
+
+    char *sq = ring->sq_ptr;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+
+    char *cq = ring->cq_ptr;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return 0;
+}
+
+void uring_exit(ms_uring_t *ring){
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr){
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->ring_fd);
+}
+
+struct io_uring_sqe* uring_get_sqe(ms_uring_t *ring){
+
+    while (ring->sq_local_tail - LOAD_ACQUIRE(ring->sq_head) >= ring->sq_entries){
+        if (uring_submit(ring, 0) == ERROR && errno != EINTR && errno != EBUSY && errno != EAGAIN){
+            perror("Submitting to io_uring");
+        }
+    }
+
+    unsigned index = ring->sq_local_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+int uring_submit(ms_uring_t *ring, unsigned wait_nr){
+
+    unsigned to_submit = ring->sq_local_tail - LOAD_ACQUIRE(ring->sq_head);
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+
+    STORE_RELEASE(ring->sq_tail, ring->sq_local_tail);
+
+    if (to_submit == 0 && wait_nr == 0){
+        return 0;
+    }
+
+    return syscall(__NR_io_uring_enter, ring->ring_fd, to_submit, wait_nr, flags, NULL, 0);
+}
+
+struct io_uring_cqe* uring_peek_cqe(ms_uring_t *ring){
+
+    unsigned head = *ring->cq_head;
+
+    if (head == LOAD_ACQUIRE(ring->cq_tail)){
+        return NULL;
+    }
+
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+void uring_cqe_seen(ms_uring_t *ring){
+    STORE_RELEASE(ring->cq_head, *ring->cq_head + 1);
+}
+
+int uring_bufs_init(ms_uring_t *ring, ms_uring_bufs_t *bufs, unsigned short group, unsigned entries, unsigned size){
+
+    struct io_uring_buf_reg reg;
+    unsigned i;
+
+    memset(bufs, 0, sizeof(ms_uring_bufs_t));
+    bufs->entries = entries;
+    bufs->size = size;
+    bufs->group = group;
+
+    /* The ring of buffer descriptors must be page aligned */
+    bufs->ring_len = entries*sizeof(struct io_uring_buf);
+    bufs->ring = mmap(NULL, bufs->ring_len, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (bufs->ring == MAP_FAILED){
+        return ERROR;
+    }
+
+    bufs->data = malloc((size_t)entries*size);
+    if (!bufs->data){
+        munmap(bufs->ring, bufs->ring_len);
+        return ERROR;
+    }
+
+    memset(&reg, 0, sizeof(struct io_uring_buf_reg));
+    reg.ring_addr = (unsigned long)bufs->ring;
+    reg.ring_entries = entries;
+    reg.bgid = group;
+
+    if (syscall(__NR_io_uring_register, ring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == ERROR){
+        free(bufs->data);
+        munmap(bufs->ring, bufs->ring_len);
+        return ERROR;
+    }
+
+    for (i=0;i<entries;i++){
+        uring_bufs_recycle(bufs, i);
+    }
+
+    return 0;
+}
+
+char* uring_bufs_get(ms_uring_bufs_t *bufs, unsigned short bid){
+    return bufs->data + (size_t)bid*bufs->size;
+}
+
+void uring_bufs_recycle(ms_uring_bufs_t *bufs, unsigned short bid){
+
+    struct io_uring_buf *buf = &bufs->ring->bufs[bufs->tail & (bufs->entries-1)];
+
+    buf->addr = (unsigned long)uring_bufs_get(bufs, bid);
+    buf->len = bufs->size;
+    buf->bid = bid;
+
+    bufs->tail++;
+    STORE_RELEASE(&bufs->ring->tail, bufs->tail);
+}
@@ -0,0 +1,123 @@
+#ifndef URING_H_
+#define URING_H_
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A struct representing an io_uring instance and its mapped rings. A
+ * ring must only be used by one thread at a time */
+typedef struct{
+    int ring_fd;
+
+    /* Submission queue */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned sq_local_tail;         /* Tail including entries not yet submitted */
+    struct io_uring_sqe *sqes;
+
+    /* Completion queue */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* Mappings to release on exit */
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+} ms_uring_t;
+
+/* A struct representing a ring of receive buffers registered with an
+ * io_uring instance. The kernel picks a buffer from the ring as each
+ * receive completes, so idle connections hold no buffer */
+typedef struct{
+    struct io_uring_buf_ring *ring;
+    size_t ring_len;
+    char *data;
+    unsigned entries;               /* Number of buffers, a power of two */
+    unsigned size;                  /* Size of each buffer in bytes */
+    unsigned short group;           /* Buffer group ID used in receives */
+    unsigned short tail;
+} ms_uring_bufs_t;
+
+/***********************************************************************
+ * func:            Creates an io_uring instance and maps its rings.
+ *                  Fails if the kernel lacks io_uring, or lacks the
+ *                  fast poll support needed to drive sockets with it.
+ *                  Returns ERROR on failure.
+ * param ring:      The ring to initialize.
+ * param entries:   The number of submission queue entries.
+***********************************************************************/
+int uring_init(ms_uring_t *ring, unsigned entries);
+
+/***********************************************************************
+ * func:            Releases an io_uring instance.
+ * param ring:      The ring to release.
+***********************************************************************/
+void uring_exit(ms_uring_t *ring);
+
+/***********************************************************************
+ * func:            Returns a cleared submission queue entry to fill
+ *                  in. Entries are only handed to the kernel by
+ *                  uring_submit, so many can be batched. If the queue
+ *                  is full, the pending entries are submitted first.
+ * param ring:      The ring to get an entry from.
+***********************************************************************/
+struct io_uring_sqe* uring_get_sqe(ms_uring_t *ring);
+
+/***********************************************************************
+ * func:            Submits all pending entries, and waits until at
+ *                  least a given number of completions are available.
+ *                  Returns ERROR on failure.
+ * param ring:      The ring to submit on.
+ * param wait_nr:   The number of completions to wait for.
+***********************************************************************/
+int uring_submit(ms_uring_t *ring, unsigned wait_nr);
+
+/***********************************************************************
+ * func:            Returns the oldest unseen completion, or NULL if
+ *                  there are none.
+ * param ring:      The ring to check.
+***********************************************************************/
+struct io_uring_cqe* uring_peek_cqe(ms_uring_t *ring);
+
+/***********************************************************************
+ * func:            Marks the completion returned by uring_peek_cqe as
+ *                  seen, freeing its slot for the kernel.
+ * param ring:      The ring the completion belongs to.
+***********************************************************************/
+void uring_cqe_seen(ms_uring_t *ring);
+
+/***********************************************************************
+ * func:            Allocates a set of receive buffers and registers
+ *                  them with a ring as a buffer group. Returns ERROR
+ *                  if the kernel does not support buffer rings.
+ * param ring:      The ring to register with.
+ * param bufs:      The buffer ring to initialize.
+ * param group:     The buffer group ID to register as.
+ * param entries:   The number of buffers, a power of two.
+ * param size:      The size of each buffer in bytes.
+***********************************************************************/
+int uring_bufs_init(ms_uring_t *ring, ms_uring_bufs_t *bufs, unsigned short group, unsigned entries, unsigned size);
+
+/***********************************************************************
+ * func:            Returns the data of a given buffer.
+ * param bufs:      The buffer ring the buffer belongs to.
+ * param bid:       The ID of the buffer, from its completion flags.
+***********************************************************************/
+char* uring_bufs_get(ms_uring_bufs_t *bufs, unsigned short bid);
+
+/***********************************************************************
+ * func:            Hands a used buffer back to the kernel.
+ * param bufs:      The buffer ring the buffer belongs to.
+ * param bid:       The ID of the buffer.
+***********************************************************************/
+void uring_bufs_recycle(ms_uring_bufs_t *bufs, unsigned short bid);
+
+#endif /* URING_H_ */
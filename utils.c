@@ -1,5 +1,10 @@
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
 
 /* Utility definitions */
 #include "utils.h"
@@ -8,27 +13,44 @@ void clear_screen(){
     system("@cls||clear");
 }
 
+int count_digits(int value){
+    int digits = 1;
+
+    while (value >= 10){
+        value /= 10;
+        digits++;
+    }
+
+    return digits;
+}
+
 void print_game(int cols, int rows, int board[cols][rows]){
 
-    int x,y;
+    int x,y,d,power;
+    int col_digits = count_digits(cols);
+    int row_digits = count_digits(rows);
 
     printf("\n");
 
-    /* If more than 10 columns, print base-10 indicies on top */
-    if (cols>=10){
-        printf("  ");
+    /* Print the higher order digits of the x axis coordinates on top,
+     * with each digit shown only where it changes */
+    for (d=col_digits-1;d>0;d--){
+        for (power=1,x=0;x<d;x++){
+            power *= 10;
+        }
+        printf("%*s", row_digits+1, "");
         for (x=1;x<=cols;x++){
-            if (x%10==0){
-                printf(" %d",x/10);
+            if (x%power==0){
+                printf(" %d",(x/power)%10);
             } else {
                 printf("  ");
-            }    
+            }
         }
         printf("\n");
     }
 
     /* Print x axis coordinates */
-    printf("  ");
+    printf("%*s", row_digits+1, "");
     for (x=1;x<=cols;x++){
         printf("|%d",x%10);
     }
@@ -38,18 +60,17 @@ void print_game(int cols, int rows, int board[cols][rows]){
     for (x=0;x<=cols;x++){
         printf("--");
     }
+    for (x=1;x<row_digits;x++){
+        printf("-");
+    }
     printf("\n");
 
     /* Print y axis */
     for (y=0;y<rows;y++){
 
-        if ((y<9 && cols>9) || cols<=9){
-            /* Print y axis coordinates */
-            printf(" %d|",y+1);
-        } else {
-            printf("%d|",y+1);
-        }
-    
+        /* Print y axis coordinates */
+        printf("%*d|", row_digits+1, y+1);
+
         for (x=0;x<cols;x++){
             /* Print y axis tile values */
             switch(board[x][y]){
@@ -86,4 +107,132 @@ void print_line(int length){
 
     printf("\n");
 
+}
+
+ms_config_t config_from_density(int cols, int rows, int density){
+    ms_config_t config;
+    int tiles = cols*rows;
+
+    config.cols = cols;
+    config.rows = rows;
+    config.bombs = (int)((long)tiles*density/100);
+    config.no_guess = false;
+
+    if (config.bombs >= tiles){
+        config.bombs = tiles-1;
+    }
+    if (config.bombs < 1){
+        config.bombs = 1;
+    }
+
+    return config;
+}
+
+uint64_t hash_string(const char *string){
+
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (;*string!='\0';string++){
+        hash ^= (unsigned char)*string;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+size_t hash_slots(size_t entries){
+
+    size_t slots = 1;
+
+    while (slots < entries*2){
+        slots <<= 1;
+    }
+
+    return slots;
+}
+
+/* Table of the CRC-32 of every byte, built on first use */
+uint32_t checksum_table[256];
+pthread_once_t checksum_once = PTHREAD_ONCE_INIT;
+
+/***********************************************************************
+ * func:            Builds the table used by checksum.
+***********************************************************************/
+void checksum_init(){
+
+    uint32_t value;
+    int i, bit;
+
+    for (i=0;i<256;i++){
+        value = i;
+        for (bit=0;bit<8;bit++){
+            value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+        }
+        checksum_table[i] = value;
+    }
+}
+
+uint32_t checksum(const void *data, size_t len){
+
+    const unsigned char *bytes = data;
+    uint32_t value = 0xFFFFFFFF;
+
+    pthread_once(&checksum_once, checksum_init);
+
+    for (;len>0;len--,bytes++){
+        value = checksum_table[(value ^ *bytes) & 0xFF] ^ (value >> 8);
+    }
+
+    return value ^ 0xFFFFFFFF;
+}
+
+void* buffer_reserve(ms_buffer_t *buffer, size_t len){
+
+    if (buffer->len + len > buffer->size){
+        size_t size = buffer->size ? buffer->size : 256;
+        while (size < buffer->len + len){
+            size *= 2;
+        }
+        char *data = realloc(buffer->data, size);
+        if (!data){
+            perror("System has run out of memory");
+            exit(EXIT_FAILURE);
+        }
+        buffer->data = data;
+        buffer->size = size;
+    }
+
+    void *space = buffer->data + buffer->len;
+    buffer->len += len;
+
+    return space;
+}
+
+void buffer_append(ms_buffer_t *buffer, const void *data, size_t len){
+    memcpy(buffer_reserve(buffer, len), data, len);
+}
+
+void buffer_consume(ms_buffer_t *buffer, size_t len){
+    if (len >= buffer->len){
+        buffer->len = 0;
+        return;
+    }
+
+    memmove(buffer->data, buffer->data + len, buffer->len - len);
+    buffer->len -= len;
+}
+
+void buffer_free(ms_buffer_t *buffer){
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->len = 0;
+    buffer->size = 0;
+}
+
+void set_low_latency(int socket_fd){
+    int enable = 1;
+
+    if (setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int)) == ERROR){
+        perror("Setting TCP_NODELAY");
+    }
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #ifndef UTILS_H_
 #define UTILS_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 /* No sys/socket.h definition */
 #define NO_FLAGS 0
 
@@ -10,8 +14,26 @@
  /* Default port if not specified */
 #define DEFAULT_PORT 1901
 
-/* Concurrent connections to be held */
-#define QUEUE_SIZE 10    
+/* Largest board dimensions the server will accept */
+#define MS_MAX_COLS 1024
+#define MS_MAX_ROWS 1024
+
+/* Highest percentage of bombs accepted on a no-guess board, above
+ * which boards that can be cleared without guessing are too rare */
+#define MS_NO_GUESS_MAX_DENSITY 25
+
+/* A struct representing the size and bomb count of a game board */
+typedef struct {
+    int cols;
+    int rows;
+    int bombs;
+    int no_guess;           /* Whether the board must be clearable without guessing */
+} ms_config_t;
+
+/* Preset game board configurations */
+#define MS_BEGINNER ((ms_config_t){9, 9, 10, false})
+#define MS_INTERMEDIATE ((ms_config_t){16, 16, 40, false})
+#define MS_EXPERT ((ms_config_t){30, 16, 99, false})
 
 /* Tile values & respective char to print */
 #define UNSELECTED_CHAR "\u25FC"
@@ -39,13 +61,20 @@ typedef enum{
     won,
     lost,
     valid,
-    invalid
+    invalid,
+    configure,
+    hint,
+    chord,
+    batch
 } req_t;
 
 /* Enums for menu types */
 typedef enum{
     main_menu,
-    game_menu
+    game_menu,
+    difficulty_menu,
+    board_type_menu,
+    scoreboard_menu
 } menu_t;
 
 /* Struct for coordinate request */
@@ -55,27 +84,80 @@ typedef struct{
     req_t request_type;
 } coord_req_t;
 
-/* Struct of a single scoreboard entry */
-typedef struct scoreboard_entry scoreboard_entry_t;
-struct scoreboard_entry{
-    int seconds_taken;
-    ms_user_t user;
-    scoreboard_entry_t* next;
-};
+/* Struct of a single changed tile, sent in network byte order after a
+ * valid reveal or flag in place of the full game board */
+typedef struct{
+    uint16_t x;
+    uint16_t y;
+    uint16_t value;
+} ms_tile_update_t;
+
+/* Struct of the header of a hint, sent after a valid response to a hint
+ * request. Chances are in hundredths of a percent. When no tile is known
+ * to be safe, it is followed by count tile updates whose values are the
+ * chances of a bomb on the hidden tiles next to revealed ones */
+typedef struct{
+    int x;                  /* A tile proven safe, -1 if none is */
+    int y;
+    int interior;           /* Chance for the other hidden tiles, -1 if none */
+    int count;              /* Tile updates that follow */
+} ms_hint_t;
+
+/* Most moves carried by a single batch request */
+#define MS_BATCH_MAX 1024
+
+/* Struct of the header of the response to a batch request. A batch
+ * request holds the number of its moves in x, and is followed by each
+ * move as a reveal, flag or chord request. The moves are applied in
+ * order until one wins or loses the game. The header is followed by
+ * the response the last move applied would get on its own, in which
+ * the tiles altered by every move are each sent once */
+typedef struct{
+    int moves;              /* Moves handled, including those skipped */
+    int invalid;            /* Moves skipped as they were not valid */
+} ms_batch_t;
+
+/* Largest page of scoreboard entries the server will send */
+#define SCOREBOARD_PAGE_MAX 100
 
-/* Struct of a user history */
-typedef struct ms_user_history ms_user_history_t;
-struct ms_user_history{
+/* Enums for scoreboard query types */
+typedef enum{
+    top_query,              /* The best entries */
+    range_query,            /* Entries from a given rank */
+    around_query            /* Entries around the best rank of the user */
+} query_t;
+
+/* Struct of a scoreboard query, sent after a scoreboard request */
+typedef struct{
+    query_t type;
+    int offset;             /* Ranks to skip, for range queries */
+    int limit;              /* Most entries to send */
+} ms_scoreboard_query_t;
+
+/* Struct of the header of a page of scoreboard entries, which is
+ * followed by its entries in display order, slowest time first */
+typedef struct{
+    int total;              /* Entries on the whole scoreboard */
+    int first_rank;         /* Rank of the best entry on the page */
+    int count;              /* Entries on the page */
+} ms_scoreboard_page_t;
+
+/* Struct of a single scoreboard entry in a page */
+typedef struct{
+    int rank;               /* Position on the scoreboard, 1 is best */
+    int seconds_taken;
     int won;
-    int lost;
-    ms_user_t user;
-};
+    int played;
+    char username[MAX_USERNAME_LEN];
+} ms_score_t;
 
-typedef struct ms_user_history_entry ms_user_history_entry_t;
-struct ms_user_history_entry{
-    ms_user_history_t user;
-    ms_user_history_entry_t* next;
-};
+/* A growable buffer, used to serialize a whole message so that it can
+ * be sent with a single system call */
+typedef struct{
+    char *data;
+    size_t len;
+    size_t size;
+} ms_buffer_t;
 
 /***********************************************************************
  * func:            Clears the screen
@@ -93,6 +175,79 @@ void clear_screen();
 ***********************************************************************/
 void print_game(int cols, int rows, int board[cols][rows]);
 
+/***********************************************************************
+ * func:            Creates a board configuration of a given size, with
+ *                  the bomb count derived from a given mine density.
+ *                  At least one bomb and one free tile are kept.
+ * param cols:      The columns/width of the game board.
+ * param rows:      The rows/height of the game board.
+ * param density:   The percentage of tiles to contain a bomb.
+***********************************************************************/
+ms_config_t config_from_density(int cols, int rows, int density);
+
+/***********************************************************************
+ * func:            Hashes a string with 64 bit FNV-1a.
+ * param string:    The string to hash.
+***********************************************************************/
+uint64_t hash_string(const char *string);
+
+/***********************************************************************
+ * func:            Returns the number of slots of an open addressing
+ *                  hash table for a given number of entries. This is
+ *                  the smallest power of two at least twice the
+ *                  entries, so the table stays at most half full and
+ *                  probes stay short, and a slot is found by masking.
+ * param entries:   The number of entries the table will hold.
+***********************************************************************/
+size_t hash_slots(size_t entries);
+
+/***********************************************************************
+ * func:            Computes the CRC-32 of a given block of memory, used
+ *                  to detect damaged data on disk.
+ * param data:      The data to check.
+ * param len:       The length of the data.
+***********************************************************************/
+uint32_t checksum(const void *data, size_t len);
+
+/***********************************************************************
+ * func:            Appends space for a given number of bytes to the
+ *                  end of a buffer, growing it if needed, and returns
+ *                  a pointer to that space.
+ * param buffer:    The buffer to append to.
+ * param len:       The number of bytes to make space for.
+***********************************************************************/
+void* buffer_reserve(ms_buffer_t *buffer, size_t len);
+
+/***********************************************************************
+ * func:            Appends a given block of data to the end of a
+ *                  buffer, growing it if needed.
+ * param buffer:    The buffer to append to.
+ * param data:      The data to append.
+ * param len:       The length of the data in bytes.
+***********************************************************************/
+void buffer_append(ms_buffer_t *buffer, const void *data, size_t len);
+
+/***********************************************************************
+ * func:            Removes a given number of bytes from the start of a
+ *                  buffer.
+ * param buffer:    The buffer to remove from.
+ * param len:       The number of bytes to remove.
+***********************************************************************/
+void buffer_consume(ms_buffer_t *buffer, size_t len);
+
+/***********************************************************************
+ * func:            Frees the memory held by a buffer.
+ * param buffer:    The buffer to free.
+***********************************************************************/
+void buffer_free(ms_buffer_t *buffer);
+
+/***********************************************************************
+ * func:            Disables Nagle's algorithm on a given socket, so
+ *                  that each message is sent as soon as it is written.
+ * param socket_fd: The socket file descriptor to configure.
+***********************************************************************/
+void set_low_latency(int socket_fd);
+
 /***********************************************************************
  * func:            Prints a beautiful line on the screen.
  * param len:       The length of the beautiful line.